@@ -0,0 +1,45 @@
+# 把资源文件转换为C数组, 编译进mcore, 启动时由resource.c注册到资源缓存
+#
+# cmake -DOUTPUT=<输出.c> -DDIR=<资源目录> -DFILES=<文件1|文件2|...> -P embed.cmake
+#
+# 每个数组结尾补一个0, 着色器源码可以直接作为字符串使用
+
+string(REPLACE "|" ";" FILES "${FILES}")
+
+# CMake的正则表达式不支持{n}, 拼出16字节的模式
+set(LINE "")
+foreach(I RANGE 15)
+    string(APPEND LINE "0x[0-9a-f][0-9a-f],")
+endforeach()
+
+set(CONTENT "/* 由cmake/embed.cmake生成, 不要修改 */\n#include \"res_embed.h\"\n\n")
+set(TABLE "")
+set(INDEX 0)
+foreach(NAME ${FILES})
+    file(READ "${DIR}/${NAME}" HEX HEX)
+    file(SIZE "${DIR}/${NAME}" SIZE)
+
+    # 每16字节一行
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," HEX "${HEX}")
+    string(REGEX REPLACE "(${LINE})" "\\1\n    " HEX "${HEX}")
+
+    string(APPEND CONTENT "// ${NAME}\nstatic const uint8_t resEmbed${INDEX}[] = {\n    ${HEX}0x00};\n\n")
+    string(APPEND TABLE "    {\"${NAME}\", resEmbed${INDEX}, ${SIZE}},\n")
+    math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+# C不允许空数组, 没有文件时保留一个空项
+if(INDEX EQUAL 0)
+    set(TABLE "    {0},\n")
+endif()
+
+string(APPEND CONTENT "const resEmbedFile resEmbedFiles[] = {\n${TABLE}};\n\nconst int resEmbedCount = ${INDEX};\n")
+
+# 内容不变时不重写, 避免重新编译
+if(EXISTS "${OUTPUT}")
+    file(READ "${OUTPUT}" OLD)
+    if(OLD STREQUAL CONTENT)
+        return()
+    endif()
+endif()
+file(WRITE "${OUTPUT}" "${CONTENT}")
@@ -0,0 +1,587 @@
+/**
+ * \file mie_cli.c
+ * \brief 无界面的批处理工具, 只依赖RDH核心和stb
+ *
+ * mie-cli <子命令> [-j 线程数] [-k 密钥] [-u] [-v] 路径...
+ *
+ * 路径全部为文件时处理单张图像; 第一个路径为目录时, 其余路径也必须是目录,
+ * 按文件名(不含扩展名)匹配, 图像输出为.png, 载荷为.bin, 额外数据m为.m
+ */
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "stb_image.h"
+#include "stb_image_write.h"
+
+#include "RDH.h"
+#include "rdh_pool.h"
+#include "trace.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#define CLI_MKDIR(path) _mkdir(path)
+#else
+#define CLI_MKDIR(path) mkdir((path), 0755)
+#endif
+
+#define CLI_PATH_MAX 1024 // 路径最大长度
+#define CLI_ARGS_MAX 6    // 子命令最多的路径数
+
+// 嵌入的载荷前有4字节小端长度, 提取时据此去掉填充
+#define CLI_PAYLOAD_HEAD 4
+
+// 路径类型
+enum
+{
+    CLI_IMG_IN,   // 输入图像
+    CLI_IMG_OUT,  // 输出图像
+    CLI_DATA_IN,  // 输入数据
+    CLI_DATA_OUT, // 输出数据
+};
+
+typedef struct
+{
+    uint64_t key;   // 洗牌密钥
+    bool unshuffle; // 恢复洗牌
+    bool verbose;   // 输出嵌入的统计信息
+} cliOpt;
+
+typedef struct _cliCmd cliCmd;
+
+typedef struct
+{
+    const cliCmd *cmd;        // 子命令
+    const cliOpt *opt;        // 选项
+    char *path[CLI_ARGS_MAX]; // 路径
+    int status;               // 返回值, 0表示成功
+    rdhStats stats;           // 嵌入的统计信息
+} cliJob;
+
+typedef struct _cliCmd
+{
+    const char *name;              // 子命令名称
+    int argc;                      // 路径数量
+    int type[CLI_ARGS_MAX];        // 路径类型
+    const char *ext[CLI_ARGS_MAX]; // 目录模式下的扩展名
+    int (*run)(cliJob *job);       // 处理函数
+    const char *usage;             // 用法
+} cliCmd;
+
+/**
+ * \brief 读取灰度图像
+ */
+static uint8_t *cliLoadImage(const char *path, int *w, int *h)
+{
+    int channels;
+    uint8_t *img = stbi_load(path, w, h, &channels, 1);
+    if (img == NULL)
+        fprintf(stderr, "读取图像 %s 失败: %s\n", path, stbi_failure_reason());
+    return img;
+}
+
+/**
+ * \brief 保存灰度图像(PNG, 无损)
+ */
+static bool cliSaveImage(const char *path, const uint8_t *img, int w, int h)
+{
+    if (stbi_write_png(path, w, h, 1, img, w) == 0)
+    {
+        fprintf(stderr, "保存图像 %s 失败\n", path);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief 读取整个文件
+ */
+static uint8_t *cliLoadData(const char *path, int *size)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "打开文件 %s 失败: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    fseek(fp, 0L, SEEK_END);
+    long fileSize = ftell(fp);
+    fseek(fp, 0L, SEEK_SET);
+
+    uint8_t *data = (uint8_t *)malloc(fileSize > 0 ? fileSize : 1);
+    if (data == NULL || fread(data, 1, fileSize, fp) != (size_t)fileSize)
+    {
+        fprintf(stderr, "读取文件 %s 失败\n", path);
+        free(data);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+
+    *size = (int)fileSize;
+    return data;
+}
+
+/**
+ * \brief 写入整个文件
+ */
+static bool cliSaveData(const char *path, const uint8_t *data, int size)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL || fwrite(data, 1, size, fp) != (size_t)size)
+    {
+        fprintf(stderr, "写入文件 %s 失败\n", path);
+        if (fp)
+            fclose(fp);
+        return false;
+    }
+    fclose(fp);
+    return true;
+}
+
+/**
+ * \brief 读取两张大小相同的份额
+ */
+static bool cliLoadShares(cliJob *job, uint8_t **img1, uint8_t **img2, int *w, int *h)
+{
+    int w2, h2;
+    *img1 = cliLoadImage(job->path[0], w, h);
+    *img2 = cliLoadImage(job->path[1], &w2, &h2);
+    if (*img1 == NULL || *img2 == NULL || *w != w2 || *h != h2)
+    {
+        if (*img1 && *img2)
+            fprintf(stderr, "份额 %s 和 %s 大小不一致\n", job->path[0], job->path[1]);
+        stbi_image_free(*img1);
+        stbi_image_free(*img2);
+        return false;
+    }
+    return true;
+}
+
+static int cliRunShuffle(cliJob *job)
+{
+    int w, h;
+    uint8_t *img = cliLoadImage(job->path[0], &w, &h);
+    if (img == NULL)
+        return 1;
+
+    if (job->opt->unshuffle)
+        rdhUnshuffleImage(img, w * h, job->opt->key);
+    else
+        rdhShuffleImage(img, w * h, job->opt->key);
+
+    bool ok = cliSaveImage(job->path[1], img, w, h);
+    stbi_image_free(img);
+    return ok ? 0 : 1;
+}
+
+static int cliRunSplit(cliJob *job)
+{
+    int w, h;
+    uint8_t *img = cliLoadImage(job->path[0], &w, &h);
+    if (img == NULL)
+        return 1;
+
+    uint8_t *img1, *img2;
+    rdhSplitImage(img, w * h, &img1, &img2);
+    stbi_image_free(img);
+
+    bool ok = cliSaveImage(job->path[1], img1, w, h) &&
+              cliSaveImage(job->path[2], img2, w, h);
+    rdhFree(img1);
+    rdhFree(img2);
+    return ok ? 0 : 1;
+}
+
+static int cliRunCombine(cliJob *job)
+{
+    int w, h;
+    uint8_t *img1, *img2;
+    if (cliLoadShares(job, &img1, &img2, &w, &h) == false)
+        return 1;
+
+    uint8_t *img;
+    rdhCombineImage(img1, img2, w * h, &img);
+    stbi_image_free(img1);
+    stbi_image_free(img2);
+
+    bool ok = cliSaveImage(job->path[2], img, w, h);
+    rdhFree(img);
+    return ok ? 0 : 1;
+}
+
+static int cliRunEmbed(cliJob *job)
+{
+    int w, h;
+    uint8_t *img1, *img2;
+    if (cliLoadShares(job, &img1, &img2, &w, &h) == false)
+        return 1;
+
+    int size = 0;
+    uint8_t *payload = cliLoadData(job->path[2], &size);
+    if (payload == NULL)
+    {
+        stbi_image_free(img1);
+        stbi_image_free(img2);
+        return 1;
+    }
+
+    // 加上长度头
+    uint8_t *data = (uint8_t *)malloc(CLI_PAYLOAD_HEAD + size);
+    if (data == NULL)
+    {
+        fprintf(stderr, "内存不足, 无法嵌入 %s\n", job->path[2]);
+        free(payload);
+        stbi_image_free(img1);
+        stbi_image_free(img2);
+        return 1;
+    }
+    for (int i = 0; i < CLI_PAYLOAD_HEAD; i++)
+        data[i] = (uint8_t)((uint32_t)size >> (8 * i));
+    memcpy(data + CLI_PAYLOAD_HEAD, payload, size);
+    free(payload);
+
+    uint8_t *m = NULL;
+    int mSize = 0;
+    bool ok = false;
+    if (rdhEmbedDataEx(img1, img2, w, h, &m, &mSize, data, CLI_PAYLOAD_HEAD + size,
+                       &job->stats, NULL, NULL) != RDH_SUCESS)
+        fprintf(stderr, "图像 %s 容量不足, 无法嵌入 %d 字节\n", job->path[0], size);
+    else
+        ok = cliSaveImage(job->path[3], img1, w, h) &&
+             cliSaveImage(job->path[4], img2, w, h) &&
+             cliSaveData(job->path[5], m, mSize);
+
+    free(data);
+    rdhFree(m);
+    stbi_image_free(img1);
+    stbi_image_free(img2);
+    return ok ? 0 : 1;
+}
+
+static int cliRunExtract(cliJob *job)
+{
+    int w, h;
+    uint8_t *img1, *img2;
+    if (cliLoadShares(job, &img1, &img2, &w, &h) == false)
+        return 1;
+
+    int mSize = 0;
+    uint8_t *m = cliLoadData(job->path[2], &mSize);
+    if (m == NULL)
+    {
+        stbi_image_free(img1);
+        stbi_image_free(img2);
+        return 1;
+    }
+
+    uint8_t *data = NULL;
+    int dataSize = 0;
+    bool ok = false;
+    if (rdhExtractDataEx(img1, img2, w, h, m, mSize, &data, &dataSize, NULL, NULL) != RDH_SUCESS ||
+        dataSize < CLI_PAYLOAD_HEAD)
+    {
+        fprintf(stderr, "从 %s 提取数据失败\n", job->path[0]);
+    }
+    else
+    {
+        uint32_t size = 0;
+        for (int i = 0; i < CLI_PAYLOAD_HEAD; i++)
+            size |= (uint32_t)data[i] << (8 * i);
+
+        if (size > (uint32_t)(dataSize - CLI_PAYLOAD_HEAD))
+            fprintf(stderr, "从 %s 提取的数据长度错误\n", job->path[0]);
+        else
+            ok = cliSaveImage(job->path[3], img1, w, h) &&
+                 cliSaveImage(job->path[4], img2, w, h) &&
+                 cliSaveData(job->path[5], data + CLI_PAYLOAD_HEAD, (int)size);
+    }
+
+    rdhFree(data);
+    free(m);
+    stbi_image_free(img1);
+    stbi_image_free(img2);
+    return ok ? 0 : 1;
+}
+
+static const cliCmd cliCmdList[] = {
+    {"shuffle", 2, {CLI_IMG_IN, CLI_IMG_OUT}, {NULL, ".png"}, cliRunShuffle,
+     "shuffle -k 密钥 [-u] 输入图像 输出图像"},
+    {"split", 3, {CLI_IMG_IN, CLI_IMG_OUT, CLI_IMG_OUT}, {NULL, ".png", ".png"}, cliRunSplit,
+     "split 输入图像 输出份额1 输出份额2"},
+    {"combine", 3, {CLI_IMG_IN, CLI_IMG_IN, CLI_IMG_OUT}, {NULL, ".png", ".png"}, cliRunCombine,
+     "combine 份额1 份额2 输出图像"},
+    {"embed", 6, {CLI_IMG_IN, CLI_IMG_IN, CLI_DATA_IN, CLI_IMG_OUT, CLI_IMG_OUT, CLI_DATA_OUT}, {NULL, ".png", ".bin", ".png", ".png", ".m"}, cliRunEmbed,
+     "embed 份额1 份额2 载荷 输出份额1 输出份额2 输出m"},
+    {"extract", 6, {CLI_IMG_IN, CLI_IMG_IN, CLI_DATA_IN, CLI_IMG_OUT, CLI_IMG_OUT, CLI_DATA_OUT}, {NULL, ".png", ".m", ".png", ".png", ".bin"}, cliRunExtract,
+     "extract 份额1 份额2 m 输出份额1 输出份额2 输出载荷"},
+};
+#define CLI_CMD_NUM (sizeof(cliCmdList) / sizeof(cliCmdList[0]))
+
+/**
+ * \brief 输出合并后的嵌入统计信息
+ */
+static void cliPrintStats(const rdhStats *stats)
+{
+    int blocks = stats->blocksUsed + stats->blocksSkipped;
+    fprintf(stderr, "块: 共 %d, 嵌入 %d, 溢出跳过 %d (%.1f%%), 平移 %d\n",
+            blocks, stats->blocksUsed, stats->blocksSkipped,
+            blocks ? 100.0 * stats->blocksSkipped / blocks : 0.0, stats->blocksShifted);
+    fprintf(stderr, "bit: 共 %lld, 平均每块 %.2f\n", (long long)stats->bits,
+            stats->blocksUsed ? (double)stats->bits / stats->blocksUsed : 0.0);
+
+    fprintf(stderr, "每块bit数:");
+    for (int i = 0; i <= RDH_STATS_BITS_MAX; i++)
+        fprintf(stderr, " %d:%d", i, stats->bitsPerBlock[i]);
+    fprintf(stderr, "\n");
+
+    // 只输出出现过的Me
+    const int *hist[2] = {stats->me1, stats->me2};
+    for (int k = 0; k < 2; k++)
+    {
+        fprintf(stderr, "Me%d:", k + 1);
+        for (int i = 0; i < RDH_STATS_ME_SIZE; i++)
+            if (hist[k][i])
+                fprintf(stderr, " %d:%d", i - RDH_STATS_ME_OFFSET, hist[k][i]);
+        fprintf(stderr, "\n");
+    }
+
+    fprintf(stderr, "耗时(ms): 复制 %.3f, 嵌入 %.3f, 写回 %.3f\n",
+            stats->time[RDH_STATS_TIME_COPY] / 1e6,
+            stats->time[RDH_STATS_TIME_EMBED] / 1e6,
+            stats->time[RDH_STATS_TIME_WRITE] / 1e6);
+}
+
+static void cliUsage(void)
+{
+    fprintf(stderr, "用法: mie-cli <子命令> [-j 线程数] [-k 密钥] [-u] [-v] 路径...\n");
+    for (size_t i = 0; i < CLI_CMD_NUM; i++)
+        fprintf(stderr, "    mie-cli %s\n", cliCmdList[i].usage);
+    fprintf(stderr, "第一个路径为目录时按文件名批量处理, 其余路径也必须是目录\n");
+    fprintf(stderr, "-v 输出embed的统计信息(溢出跳过的块, 每块bit数, Me分布, 各阶段耗时)\n");
+}
+
+static bool cliIsDir(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static void cliJobRun(int worker, void *arg)
+{
+    (void)worker;
+    cliJob *job = (cliJob *)arg;
+    job->status = job->cmd->run(job);
+}
+
+static void cliJobFree(cliJob *job)
+{
+    for (int i = 0; i < CLI_ARGS_MAX; i++)
+        free(job->path[i]);
+}
+
+/**
+ * \brief 拼接路径"目录/文件名扩展名", 超过CLI_PATH_MAX时失败, 避免截断后写到错误的文件
+ * \param path 输出, 大小为CLI_PATH_MAX
+ * \return 是否成功
+ */
+static bool cliPath(char *path, const char *dir, const char *name, const char *ext)
+{
+    int len = snprintf(path, CLI_PATH_MAX, "%s/%s%s", dir, name, ext);
+    if (len < 0 || len >= CLI_PATH_MAX)
+    {
+        fprintf(stderr, "路径过长: %s/%s%s\n", dir, name, ext);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief 按目录模式生成任务
+ * \return 任务数量, 失败返回-1
+ */
+static int cliListJobs(const cliCmd *cmd, const cliOpt *opt, char **dirs, cliJob **jobs)
+{
+    DIR *dir = opendir(dirs[0]);
+    if (dir == NULL)
+    {
+        fprintf(stderr, "打开目录 %s 失败\n", dirs[0]);
+        return -1;
+    }
+
+    // 创建输出目录
+    for (int i = 1; i < cmd->argc; i++)
+        if (cmd->type[i] == CLI_IMG_OUT || cmd->type[i] == CLI_DATA_OUT)
+            CLI_MKDIR(dirs[i]);
+
+    int count = 0, max = 0;
+    *jobs = NULL;
+
+    struct dirent *ent;
+    bool ok = true;
+    while (ok && (ent = readdir(dir)) != NULL)
+    {
+        char path[CLI_PATH_MAX];
+        if (cliPath(path, dirs[0], ent->d_name, "") == false)
+        {
+            ok = false;
+            break;
+        }
+        if (ent->d_name[0] == '.' || cliIsDir(path))
+            continue;
+
+        // 去掉扩展名
+        char base[CLI_PATH_MAX];
+        snprintf(base, sizeof(base), "%s", ent->d_name);
+        char *dot = strrchr(base, '.');
+        if (dot)
+            *dot = '\0';
+
+        if (count == max)
+        {
+            max = max ? max * 2 : 16;
+            cliJob *grow = (cliJob *)realloc(*jobs, sizeof(cliJob) * max);
+            if (grow == NULL)
+            {
+                fprintf(stderr, "内存不足\n");
+                ok = false;
+                break;
+            }
+            *jobs = grow;
+        }
+        cliJob *job = &(*jobs)[count++];
+        memset(job, 0, sizeof(cliJob));
+        job->cmd = cmd;
+        job->opt = opt;
+        job->path[0] = strdup(path);
+        for (int i = 1; ok && i < cmd->argc; i++)
+        {
+            ok = cliPath(path, dirs[i], base, cmd->ext[i]);
+            if (ok)
+                job->path[i] = strdup(path);
+        }
+    }
+    closedir(dir);
+
+    // 路径过长或内存不足时不处理任何文件
+    if (ok == false)
+    {
+        for (int i = 0; i < count; i++)
+            cliJobFree(&(*jobs)[i]);
+        free(*jobs);
+        *jobs = NULL;
+        return -1;
+    }
+    return count;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        cliUsage();
+        return 1;
+    }
+
+    // 查找子命令
+    const cliCmd *cmd = NULL;
+    for (size_t i = 0; i < CLI_CMD_NUM; i++)
+        if (strcmp(argv[1], cliCmdList[i].name) == 0)
+            cmd = &cliCmdList[i];
+    if (cmd == NULL)
+    {
+        fprintf(stderr, "未知的子命令: %s\n", argv[1]);
+        cliUsage();
+        return 1;
+    }
+
+    // 解析选项
+    cliOpt opt = {0};
+    int threads = 1;
+    bool hasKey = false;
+    char *paths[CLI_ARGS_MAX];
+    int pathCount = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+        {
+            opt.key = strtoull(argv[++i], NULL, 0);
+            hasKey = true;
+        }
+        else if (strcmp(argv[i], "-u") == 0)
+            opt.unshuffle = true;
+        else if (strcmp(argv[i], "-v") == 0)
+            opt.verbose = true;
+        else if (pathCount < CLI_ARGS_MAX)
+            paths[pathCount++] = argv[i];
+        else
+            pathCount++;
+    }
+    if (pathCount != cmd->argc || (cmd->run == cliRunShuffle && hasKey == false))
+    {
+        fprintf(stderr, "用法: mie-cli %s\n", cmd->usage);
+        return 1;
+    }
+
+    srand((unsigned int)time(NULL));
+
+    // 单个文件
+    if (cliIsDir(paths[0]) == false)
+    {
+        cliJob job = {.cmd = cmd, .opt = &opt};
+        for (int i = 0; i < cmd->argc; i++)
+            job.path[i] = strdup(paths[i]);
+        int status = cmd->run(&job);
+        if (opt.verbose && cmd->run == cliRunEmbed)
+            cliPrintStats(&job.stats);
+        cliJobFree(&job);
+        TRACE_DUMP(NULL);
+        return status;
+    }
+
+    // 目录模式
+    cliJob *jobs;
+    int count = cliListJobs(cmd, &opt, paths, &jobs);
+    if (count < 0)
+        return 1;
+
+    rdhPool *pool = rdhPoolCreate(threads);
+    if (pool == NULL)
+    {
+        fprintf(stderr, "创建线程池失败\n");
+        return 1;
+    }
+    for (int i = 0; i < count; i++)
+        rdhPoolSubmit(pool, cliJobRun, &jobs[i]);
+    rdhPoolDestroy(pool);
+
+    // 汇总结果, 每个文件的统计信息单独收集, 最后合并
+    int failed = 0;
+    rdhStats stats;
+    rdhStatsInit(&stats);
+    for (int i = 0; i < count; i++)
+    {
+        if (jobs[i].status != 0)
+            failed++;
+        rdhStatsMerge(&stats, &jobs[i].stats);
+        cliJobFree(&jobs[i]);
+    }
+    if (opt.verbose && cmd->run == cliRunEmbed)
+        cliPrintStats(&stats);
+    free(jobs);
+    TRACE_DUMP(NULL);
+
+    fprintf(stderr, "%s: 共 %d 个文件, 失败 %d 个\n", cmd->name, count, failed);
+    return failed ? 1 : 0;
+}
@@ -1,4 +1,5 @@
 #include "RDH.h"
+#include "trace.h"
 
 // 内存对齐
 #define RDH_MALLOC_SIZE(size) (((size) + 7) & ~7)
@@ -15,14 +16,38 @@
 // 图像数据位置
 #define RDH_IMG_POS(img, w, x, y) ((img)[(y) * (w) + (x)])
 
-// 图像哈希表
-static uint8_t hash[4 * RDH_IMG_GET_HIGH(RDH_IMG_MASK_HIGH) + 1];
+// 当前线程的内存分配器, 为NULL时使用malloc/free
+static _Thread_local void *(*rdhAllocMalloc)(void *arg, size_t size) = NULL;
+static _Thread_local void (*rdhAllocFree)(void *arg, void *data) = NULL;
+static _Thread_local void *rdhAllocArg = NULL;
+
+/**
+ * \brief 重新分配空间, 自定义分配器没有realloc, 需要复制
+ * \param data 原数据
+ * \param oldSize 原大小
+ * \param size 新大小
+ */
+static void *rdhRealloc(void *data, size_t oldSize, size_t size)
+{
+    if (rdhAllocMalloc == NULL)
+        return realloc(data, RDH_MALLOC_SIZE(size));
+
+    void *newData = rdhMalloc(size);
+    memcpy(newData, data, oldSize < size ? oldSize : size);
+    rdhFree(data);
+    return newData;
+}
+
+// 图像哈希表(每次调用独立, 保证多线程安全)
+#define RDH_HASH_SIZE (4 * RDH_IMG_GET_HIGH(RDH_IMG_MASK_HIGH) + 1)
 #define RDH_HASH_INIT() memset(hash, 0, sizeof(hash))
 #define RDH_HASH_GET(x) (hash)[2 * RDH_IMG_GET_HIGH(RDH_IMG_MASK_HIGH) + (x)]
 #define RDH_HASH_SET(x) (RDH_HASH_GET(x)++)
 
 void rdhShuffleImage(uint8_t *img, int size, uint64_t key)
 {
+    TRACE_ZONE("rdhShuffleImage");
+
     uint64_t *chunk = (uint64_t *)img;
     size /= sizeof(uint64_t) / sizeof(uint8_t);
     xSrand32(key);
@@ -37,11 +62,13 @@ void rdhShuffleImage(uint8_t *img, int size, uint64_t key)
 
 void rdhUnshuffleImage(uint8_t *img, int size, uint64_t key)
 {
+    TRACE_ZONE("rdhUnshuffleImage");
+
     uint64_t *chunk = (uint64_t *)img;
     size /= sizeof(uint64_t) / sizeof(uint8_t);
     xSrand32(key);
-    int *indices = (int *)malloc(size * sizeof(int));
-    uint64_t *tempData = (uint64_t *)malloc(size * sizeof(uint64_t));
+    int *indices = (int *)rdhMalloc(size * sizeof(int));
+    uint64_t *tempData = (uint64_t *)rdhMalloc(size * sizeof(uint64_t));
 
     // 初始化索引数组
     for (int i = 0; i < size; i++)
@@ -67,8 +94,8 @@ void rdhUnshuffleImage(uint8_t *img, int size, uint64_t key)
     // 将恢复后的数据复制回原数组
     memcpy(chunk, tempData, size * sizeof(uint64_t));
 
-    free(indices);
-    free(tempData);
+    rdhFree(indices);
+    rdhFree(tempData);
 }
 
 void rdhSplitImage(const uint8_t *img, int size, uint8_t **img1, uint8_t **img2)
@@ -76,9 +103,16 @@ void rdhSplitImage(const uint8_t *img, int size, uint8_t **img1, uint8_t **img2)
     *img1 = (uint8_t *)rdhMalloc(size);
     *img2 = (uint8_t *)rdhMalloc(size);
 
+    rdhSplitImageTo(img, size, *img1, *img2);
+}
+
+void rdhSplitImageTo(const uint8_t *img, int size, uint8_t *img1, uint8_t *img2)
+{
+    TRACE_ZONE("rdhSplitImage");
+
     const uint8_t *t = img;
-    uint8_t *t1 = *img1;
-    uint8_t *t2 = *img2;
+    uint8_t *t1 = img1;
+    uint8_t *t2 = img2;
 
     // srand((unsigned int)time(NULL));
     xSrand8(rand());
@@ -112,8 +146,15 @@ void rdhCombineImage(const uint8_t *img1, const uint8_t *img2, int size, uint8_t
 {
     *img = (uint8_t *)rdhMalloc(size);
 
+    rdhCombineImageTo(img1, img2, size, *img);
+}
+
+void rdhCombineImageTo(const uint8_t *img1, const uint8_t *img2, int size, uint8_t *img)
+{
+    TRACE_ZONE("rdhCombineImage");
+
     uint8_t *t, *t1, *t2;
-    t = *img;
+    t = img;
     t1 = (uint8_t *)img1;
     t2 = (uint8_t *)img2;
 
@@ -172,12 +213,28 @@ void rdhCombineImage(const uint8_t *img1, const uint8_t *img2, int size, uint8_t
 // 数据的内存操作
 #define RDH_DATA_SIZE_INIT 0x10
 #define RDH_DATA_SIZE_TSD 0x08
-#define RDH_DATA_SIZE_ADD 0x10
+#define RDH_DATA_SIZE_GROW 2 // 按倍数扩展, 避免大数据时反复复制
+
+// 累计阶段耗时, last为上一阶段结束的时间
+#define RDH_STATS_TIME(stats, last, stage)           \
+    do                                               \
+    {                                                \
+        if (stats)                                   \
+        {                                            \
+            uint64_t _now = traceNow();              \
+            (stats)->time[(stage)] += _now - (last); \
+            (last) = _now;                           \
+        }                                            \
+    } while (0)
 
 // 向下取整的除法
 #define RDH_DIVIDE_BY_2_FLOOR(num) ((num) >> 1)
 #define RDH_DIVIDE_BY_4_FLOOR(num) ((num) >> 2)
 
+// Me在统计直方图中的下标, 超出范围的值计入两端
+#define RDH_STATS_ME_INDEX(me) \
+    ((me) < -RDH_STATS_ME_OFFSET ? 0 : ((me) > RDH_STATS_ME_OFFSET ? RDH_STATS_ME_SIZE - 1 : (me) + RDH_STATS_ME_OFFSET))
+
 typedef struct
 {
     uint8_t EP[5];
@@ -187,23 +244,18 @@ typedef struct
 #define RDH_CHUNK_SP(chunk, i) ((chunk).SP[((i) - 1) & 3]) // &3是为了防止在SP和EP同时操作时出现数组越界，不会影响结果
 
 /**
- * \brief 嵌入数据
- * \param img1Line1 图像1行1
- * \param img1Line2 图像1行2
- * \param img1Line3 图像1行3
- * \param img2Line1 图像2行1
- * \param img2Line2 图像2行2
- * \param img2Line3 图像2行3
- * \param byte 字节流
- * \param total bit位总数
- * \param now 当前bit位
- * \return 嵌入的额外数据
+ * \brief 嵌入数据, 同rdhEmbedDataByte
+ * \param stats 统计信息, 可以为NULL
  */
-uint8_t rdhEmbedDataByte(uint8_t *img1Line1, uint8_t *img1Line2, uint8_t *img1Line3,
-                         uint8_t *img2Line1, uint8_t *img2Line2, uint8_t *img2Line3,
-                         const uint8_t *byte, int total, int *now)
+static inline uint8_t rdhEmbedBlock(uint8_t *img1Line1, uint8_t *img1Line2, uint8_t *img1Line3,
+                                    uint8_t *img2Line1, uint8_t *img2Line2, uint8_t *img2Line3,
+                                    const uint8_t *byte, int total, int *now,
+                                    rdhStats *stats)
 {
     uint8_t m = 0;
+    uint8_t hash[RDH_HASH_SIZE];
+    int start = *now;      // 本块开始时的bit位
+    bool shifted = false; // 是否有像素被平移
 
     // 获取采样像素采样像素 SPs 和可嵌入像素 EPs
     rdhChunk imgChunk1;
@@ -233,6 +285,8 @@ uint8_t rdhEmbedDataByte(uint8_t *img1Line1, uint8_t *img1Line2, uint8_t *img1Li
         if (RDH_CHUNK_EP(imgChunk1, i + 1) > RDH_EP_VALUE_MAX ||
             RDH_CHUNK_SP(imgChunk1, i + 1) > RDH_SP_VALUE_MAX)
         {
+            if (stats)
+                stats->blocksSkipped++;
             return 0;
         }
 
@@ -316,6 +370,7 @@ uint8_t rdhEmbedDataByte(uint8_t *img1Line1, uint8_t *img1Line2, uint8_t *img1Li
         {
             RDH_CHUNK_EP(imgChunk1, i + 1) += RDH_EP_VALUE_ADD;
             RDH_CHUNK_EP(imgChunkHSB1, i + 1) += RDH_EP_VALUE_ADD_HSB;
+            shifted = true;
         }
         else // 小于峰值不变
         {
@@ -375,6 +430,7 @@ uint8_t rdhEmbedDataByte(uint8_t *img1Line1, uint8_t *img1Line2, uint8_t *img1Li
         else if (sdHSB[i] > Me2) // 大于峰值，直方图平移
         {
             RDH_CHUNK_SP(imgChunk1, i + 1) += RDH_SP_VALUE_ADD;
+            shifted = true;
         }
         else // 小于峰值不变
         {
@@ -405,9 +461,28 @@ uint8_t rdhEmbedDataByte(uint8_t *img1Line1, uint8_t *img1Line2, uint8_t *img1Li
     // 设置m
     RDH_M_SET(m, 1, INUSE);
 
+    // 统计
+    if (stats)
+    {
+        stats->blocksUsed++;
+        stats->blocksShifted += shifted;
+        stats->bitsPerBlock[*now - start]++;
+        stats->me1[RDH_STATS_ME_INDEX(Me1)]++;
+        stats->me2[RDH_STATS_ME_INDEX(Me2)]++;
+    }
+
     return m;
 }
 
+uint8_t rdhEmbedDataByte(uint8_t *img1Line1, uint8_t *img1Line2, uint8_t *img1Line3,
+                         uint8_t *img2Line1, uint8_t *img2Line2, uint8_t *img2Line3,
+                         const uint8_t *byte, int total, int *now)
+{
+    return rdhEmbedBlock(img1Line1, img1Line2, img1Line3,
+                         img2Line1, img2Line2, img2Line3,
+                         byte, total, now, NULL);
+}
+
 /**
  * \brief 提取数据
  * \param img1Line1 图像1行1
@@ -598,6 +673,60 @@ rdhStatus rdhEmbedData(uint8_t *img1, uint8_t *img2,
                        uint8_t **m, int *mSize,
                        const uint8_t *data, int size)
 {
+    return rdhEmbedDataEx(img1, img2, w, h, m, mSize, data, size, NULL, NULL, NULL);
+}
+
+/**
+ * \brief 逐块嵌入数据, 直接修改图像
+ * \param m 额外数据, 容量至少(w / 3) * (h / 3)
+ * \param size 数据的bit数
+ * \param now 已嵌入的bit数
+ * \return 状态码, 数据嵌入完毕时返回RDH_SUCESS
+ */
+static rdhStatus rdhEmbedBlocks(uint8_t *img1, uint8_t *img2,
+                                int w, int h,
+                                uint8_t *m, int *mSize,
+                                const uint8_t *data, int size, int *now,
+                                rdhStats *stats,
+                                rdhProgressFun progress, void *arg)
+{
+    for (int i = 0; i < w - 2; i += 3)
+    {
+        for (int j = 0; j < h - 2; j += 3)
+        {
+            m[(*mSize)++] = rdhEmbedBlock(&RDH_IMG_POS(img1, w, i, j), &RDH_IMG_POS(img1, w, i, j + 1), &RDH_IMG_POS(img1, w, i, j + 2),
+                                          &RDH_IMG_POS(img2, w, i, j), &RDH_IMG_POS(img2, w, i, j + 1), &RDH_IMG_POS(img2, w, i, j + 2),
+                                          data, size, now, stats);
+            // 检查数据是否嵌入完毕
+            if (*now >= size)
+                return RDH_SUCESS;
+        }
+
+        // 每处理完一列报告一次进度, 返回false表示取消
+        if (progress && progress(arg, *mSize, *now) == false)
+            return RDH_CANCEL;
+    }
+    return RDH_ERROR;
+}
+
+rdhStatus rdhEmbedDataEx(uint8_t *img1, uint8_t *img2,
+                         int w, int h,
+                         uint8_t **m, int *mSize,
+                         const uint8_t *data, int size,
+                         rdhStats *stats,
+                         rdhProgressFun progress, void *arg)
+{
+    TRACE_ZONE("rdhEmbedData");
+    uint64_t time = stats ? traceNow() : 0;
+
+    // 安全检查, 转换为bit数时不能溢出
+    if (size < 0 || size > RDH_DATA_SIZE_MAX)
+    {
+        *m = NULL;
+        *mSize = 0;
+        return RDH_ERROR;
+    }
+
     // 将size转化为字节流大小
     size = RDH_DATA_BYTE_2_BIT(size);
 
@@ -610,33 +739,26 @@ rdhStatus rdhEmbedData(uint8_t *img1, uint8_t *img2,
     uint8_t *img2Copy = (uint8_t *)rdhMalloc(w * h);
     memcpy(img1Copy, img1, w * h);
     memcpy(img2Copy, img2, w * h);
+    RDH_STATS_TIME(stats, time, RDH_STATS_TIME_COPY);
 
     // 嵌入数据
     int now = 0;
-    for (int i = 0; i < w - 2; i += 3)
+    rdhStatus status = rdhEmbedBlocks(img1Copy, img2Copy, w, h, *m, mSize, data, size, &now, stats, progress, arg);
+    RDH_STATS_TIME(stats, time, RDH_STATS_TIME_EMBED);
+    if (stats)
+        stats->bits += now;
+
+    if (status != RDH_SUCESS)
     {
-        for (int j = 0; j < h - 2; j += 3)
-        {
-            (*m)[(*mSize)++] = rdhEmbedDataByte(&RDH_IMG_POS(img1Copy, w, i, j), &RDH_IMG_POS(img1Copy, w, i, j + 1), &RDH_IMG_POS(img1Copy, w, i, j + 2),
-                                                &RDH_IMG_POS(img2Copy, w, i, j), &RDH_IMG_POS(img2Copy, w, i, j + 1), &RDH_IMG_POS(img2Copy, w, i, j + 2),
-                                                data, size, &now);
-            // 检查数据是否嵌入完毕
-            if (now >= size)
-            {
-                goto SUCESS;
-            }
-        }
+        // 释放内存, 原图像未被修改, 统计中仍然包含已处理的块
+        rdhFree(img1Copy);
+        rdhFree(img2Copy);
+        rdhFree(*m);
+        *m = NULL;
+        *mSize = 0;
+        return status;
     }
 
-    // 释放内存
-    rdhFree(img1Copy);
-    rdhFree(img2Copy);
-    rdhFree(*m);
-    *mSize = 0;
-
-    return RDH_ERROR;
-
-SUCESS:
     // 复制图像数据
     memcpy(img1, img1Copy, w * h);
     memcpy(img2, img2Copy, w * h);
@@ -646,22 +768,69 @@ SUCESS:
     rdhFree(img2Copy);
 
     // 调整m大小
-    *m = (uint8_t *)realloc(*m, *mSize);
+    *m = (uint8_t *)rdhRealloc(*m, (w / 3) * (h / 3), *mSize);
+    RDH_STATS_TIME(stats, time, RDH_STATS_TIME_WRITE);
+
+    // 报告最终进度
+    if (progress)
+        progress(arg, *mSize, now);
 
     return RDH_SUCESS;
 }
 
+rdhStatus rdhEmbedDataTo(uint8_t *img1, uint8_t *img2,
+                         int w, int h,
+                         uint8_t *m, int *mSize,
+                         const uint8_t *data, int size)
+{
+    TRACE_ZONE("rdhEmbedDataTo");
+
+    *mSize = 0;
+
+    // 安全检查, 转换为bit数时不能溢出
+    if (size < 0 || size > RDH_DATA_SIZE_MAX)
+        return RDH_ERROR;
+
+    int now = 0;
+    rdhStatus status = rdhEmbedBlocks(img1, img2, w, h, m, mSize, data, RDH_DATA_BYTE_2_BIT(size), &now, NULL, NULL, NULL);
+    if (status != RDH_SUCESS)
+        *mSize = 0;
+    return status;
+}
+
 rdhStatus rdhExtractData(uint8_t *img1, uint8_t *img2,
                          int w, int h,
                          const uint8_t *m, int mSize,
                          uint8_t **data)
 {
+    return rdhExtractDataEx(img1, img2, w, h, m, mSize, data, NULL, NULL, NULL);
+}
+
+rdhStatus rdhExtractDataEx(uint8_t *img1, uint8_t *img2,
+                           int w, int h,
+                           const uint8_t *m, int mSize,
+                           uint8_t **data, int *dataSize,
+                           rdhProgressFun progress, void *arg)
+{
+    TRACE_ZONE("rdhExtractData");
+
     // 安全检查
     if (mSize > (w / 3) * (h / 3))
     {
         return RDH_ERROR;
     }
 
+    // 可以取消时在副本上恢复图像, 取消后原图像保持不变
+    uint8_t *img1Work = img1;
+    uint8_t *img2Work = img2;
+    if (progress)
+    {
+        img1Work = (uint8_t *)rdhMalloc(w * h);
+        img2Work = (uint8_t *)rdhMalloc(w * h);
+        memcpy(img1Work, img1, w * h);
+        memcpy(img2Work, img2, w * h);
+    }
+
     // 为data分配初始内存
     int size = RDH_DATA_SIZE_INIT;
     *data = (uint8_t *)rdhMalloc(size);
@@ -670,37 +839,101 @@ rdhStatus rdhExtractData(uint8_t *img1, uint8_t *img2,
     // 提取数据
     int now = 0;
     int mindex = 0;
-    for (int i = 0; i < w - 2; i += 3)
+    for (int i = 0; i < w - 2 && mindex < mSize; i += 3)
     {
         for (int j = 0; j < h - 2; j += 3)
         {
             // 检查是否结束
             if (mindex >= mSize)
             {
-                return RDH_SUCESS;
+                break;
             }
             // 检查空间是否足够
             if (RDH_DATA_BIT_2_BYTE(now) >= size - RDH_DATA_SIZE_TSD)
             {
-                size += RDH_DATA_SIZE_ADD;
-                *data = (uint8_t *)realloc(*data, size);
-                memset(*data + size - RDH_DATA_SIZE_ADD, 0, RDH_DATA_SIZE_ADD);
+                int oldSize = size;
+                size *= RDH_DATA_SIZE_GROW;
+                *data = (uint8_t *)rdhRealloc(*data, oldSize, size);
+                memset(*data + oldSize, 0, size - oldSize);
             }
-            rdhExtractDataByte(&RDH_IMG_POS(img1, w, i, j), &RDH_IMG_POS(img1, w, i, j + 1), &RDH_IMG_POS(img1, w, i, j + 2),
-                               &RDH_IMG_POS(img2, w, i, j), &RDH_IMG_POS(img2, w, i, j + 1), &RDH_IMG_POS(img2, w, i, j + 2),
+            rdhExtractDataByte(&RDH_IMG_POS(img1Work, w, i, j), &RDH_IMG_POS(img1Work, w, i, j + 1), &RDH_IMG_POS(img1Work, w, i, j + 2),
+                               &RDH_IMG_POS(img2Work, w, i, j), &RDH_IMG_POS(img2Work, w, i, j + 1), &RDH_IMG_POS(img2Work, w, i, j + 2),
                                *data, &now, m[mindex++]);
         }
+
+        // 每处理完一列报告一次进度, 返回false表示取消
+        if (progress && progress(arg, mindex, now) == false)
+        {
+            rdhFree(img1Work);
+            rdhFree(img2Work);
+            rdhFree(*data);
+            *data = NULL;
+            if (dataSize)
+                *dataSize = 0;
+            return RDH_CANCEL;
+        }
     }
 
+    // 写回恢复后的图像
+    if (progress)
+    {
+        memcpy(img1, img1Work, w * h);
+        memcpy(img2, img2Work, w * h);
+        rdhFree(img1Work);
+        rdhFree(img2Work);
+    }
+
+    // 提取的字节数
+    if (dataSize)
+        *dataSize = RDH_DATA_BIT_2_BYTE(now + 7);
+
     // 检查是否提取完成
     return RDH_SUCESS;
 }
 
+void rdhStatsInit(rdhStats *stats)
+{
+    memset(stats, 0, sizeof(rdhStats));
+}
+
+void rdhStatsMerge(rdhStats *dst, const rdhStats *src)
+{
+    dst->blocksSkipped += src->blocksSkipped;
+    dst->blocksUsed += src->blocksUsed;
+    dst->blocksShifted += src->blocksShifted;
+    dst->bits += src->bits;
+    for (int i = 0; i <= RDH_STATS_BITS_MAX; i++)
+        dst->bitsPerBlock[i] += src->bitsPerBlock[i];
+    for (int i = 0; i < RDH_STATS_ME_SIZE; i++)
+    {
+        dst->me1[i] += src->me1[i];
+        dst->me2[i] += src->me2[i];
+    }
+    for (int i = 0; i < RDH_STATS_TIME_NUM; i++)
+        dst->time[i] += src->time[i];
+}
+
 void *rdhMalloc(size_t size)
 {
+    if (rdhAllocMalloc)
+        return rdhAllocMalloc(rdhAllocArg, RDH_MALLOC_SIZE(size));
     return malloc(RDH_MALLOC_SIZE(size));
 }
 void rdhFree(void *data)
 {
-    free(data);
+    if (data == NULL)
+        return;
+    if (rdhAllocFree)
+        rdhAllocFree(rdhAllocArg, data);
+    else
+        free(data);
+}
+
+void rdhSetAllocator(void *(*mallocFun)(void *arg, size_t size),
+                     void (*freeFun)(void *arg, void *data),
+                     void *arg)
+{
+    rdhAllocMalloc = (mallocFun && freeFun) ? mallocFun : NULL;
+    rdhAllocFree = (mallocFun && freeFun) ? freeFun : NULL;
+    rdhAllocArg = arg;
 }
\ No newline at end of file
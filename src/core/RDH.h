@@ -8,6 +8,7 @@
 #define _CRT_RAND_S
 #include <time.h>
 #include <stdio.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <stdbool.h>
 
@@ -17,10 +18,65 @@
 enum
 {
     RDH_SUCESS = 0,
-    RDH_ERROR
+    RDH_ERROR,
+    RDH_CANCEL
 };
 typedef int rdhStatus;
 
+// 嵌入数据的最大大小(字节), 转换为bit数时不能超出int
+#define RDH_DATA_SIZE_MAX (INT_MAX / 8)
+
+// 统计信息的范围
+#define RDH_STATS_BITS_MAX 9     // 每块最多嵌入的bit数(5个EP + 4个SP)
+#define RDH_STATS_ME_OFFSET 64   // Me直方图的偏移, Me1/Me2的范围约为[-62, 62]
+#define RDH_STATS_ME_SIZE (2 * RDH_STATS_ME_OFFSET + 1)
+
+// 统计的阶段耗时
+enum
+{
+    RDH_STATS_TIME_COPY,  // 分配空间和复制图像
+    RDH_STATS_TIME_EMBED, // 逐块嵌入
+    RDH_STATS_TIME_WRITE, // 写回图像和调整m大小
+    RDH_STATS_TIME_NUM
+};
+
+/**
+ * \brief 嵌入的统计信息, 每个线程(或每次调用)单独收集, 最后用rdhStatsMerge合并
+ */
+typedef struct
+{
+    int blocksSkipped;                        // 因溢出跳过的块数(m为0)
+    int blocksUsed;                           // 参与嵌入的块数
+    int blocksShifted;                        // 有像素被直方图平移的块数
+    int64_t bits;                             // 嵌入的bit数
+    int bitsPerBlock[RDH_STATS_BITS_MAX + 1]; // 每块嵌入bit数的分布
+    int me1[RDH_STATS_ME_SIZE];               // Me1的分布, 下标为Me1 + RDH_STATS_ME_OFFSET
+    int me2[RDH_STATS_ME_SIZE];               // Me2的分布, 下标为Me2 + RDH_STATS_ME_OFFSET
+    uint64_t time[RDH_STATS_TIME_NUM];        // 各阶段耗时(ns)
+} rdhStats;
+
+/**
+ * \brief 清空统计信息
+ * \param stats 统计信息
+ */
+void rdhStatsInit(rdhStats *stats);
+
+/**
+ * \brief 把src累加到dst
+ * \param dst 目标
+ * \param src 来源
+ */
+void rdhStatsMerge(rdhStats *dst, const rdhStats *src);
+
+/**
+ * \brief 进度回调, 嵌入和提取时每处理完一列块调用一次
+ * \param arg 用户参数
+ * \param blocks 已处理的块数
+ * \param bits 已嵌入或提取的bit数
+ * \return 是否继续, 返回false则取消并回滚
+ */
+typedef bool (*rdhProgressFun)(void *arg, int blocks, int bits);
+
 /**
  * \brief 使用洗牌算法打乱和恢复图像数据
  * \param img 图像数据
@@ -40,6 +96,13 @@ void rdhUnshuffleImage(uint8_t *img, int size, uint64_t key);
 void rdhSplitImage(const uint8_t *img, int size, uint8_t **img1, uint8_t **img2);
 void rdhCombineImage(const uint8_t *img1, const uint8_t *img2, int size, uint8_t **img);
 
+/**
+ * \brief 同rdhSplitImage和rdhCombineImage, 但写入调用者提供的空间
+ * \note 结果与分配空间的版本完全相同
+ */
+void rdhSplitImageTo(const uint8_t *img, int size, uint8_t *img1, uint8_t *img2);
+void rdhCombineImageTo(const uint8_t *img1, const uint8_t *img2, int size, uint8_t *img);
+
 /**
  * \brief 嵌入bit流的数据
  * \param img1Line1 图像1行1
@@ -81,7 +144,7 @@ void rdhExtractDataByte(uint8_t *img1Line1, uint8_t *img1Line2, uint8_t *img1Lin
  * \param w 宽度
  * \param h 高度
  * \param data 数据
- * \param size 数据大小
+ * \param size 数据大小, 不能为负数或超过RDH_DATA_SIZE_MAX
  * \param m 嵌入的额外数据
  * \param mSize 额外数据大小
  * \return 状态码
@@ -91,6 +154,18 @@ rdhStatus rdhEmbedData(uint8_t *img1, uint8_t *img2,
                        uint8_t **m, int *mSize,
                        const uint8_t *data, int size);
 
+/**
+ * \brief 同rdhEmbedData, 但直接在份额上嵌入, m写入调用者提供的空间, 不分配和复制图像
+ * \param m 额外数据, 容量至少为(w / 3) * (h / 3)
+ * \param mSize 额外数据大小, 失败时为0
+ * \return 状态码
+ * \note 失败时份额可能已被部分修改, 需要保留原份额时使用rdhEmbedData
+ */
+rdhStatus rdhEmbedDataTo(uint8_t *img1, uint8_t *img2,
+                         int w, int h,
+                         uint8_t *m, int *mSize,
+                         const uint8_t *data, int size);
+
 /**
  * \brief 提取数据
  * \param img1 图像份额1
@@ -107,6 +182,35 @@ rdhStatus rdhExtractData(uint8_t *img1, uint8_t *img2,
                          const uint8_t *m, int mSize,
                          uint8_t **data);
 
+/**
+ * \brief 可收集统计信息, 报告进度和取消的嵌入数据
+ * \param stats 统计信息, 可以为NULL, 结果累加到其中(失败或取消时也包含已处理的块)
+ * \param progress 进度回调, 可以为NULL
+ * \param arg 回调参数
+ * \return 状态码, 取消时返回RDH_CANCEL且图像不被修改
+ * \note 其余参数同rdhEmbedData
+ */
+rdhStatus rdhEmbedDataEx(uint8_t *img1, uint8_t *img2,
+                         int w, int h,
+                         uint8_t **m, int *mSize,
+                         const uint8_t *data, int size,
+                         rdhStats *stats,
+                         rdhProgressFun progress, void *arg);
+
+/**
+ * \brief 可报告进度和取消的提取数据
+ * \param dataSize 提取的数据大小, 可以为NULL
+ * \param progress 进度回调, 可以为NULL, 不为NULL时在副本上恢复图像
+ * \param arg 回调参数
+ * \return 状态码, 取消时返回RDH_CANCEL且图像不被修改
+ * \note 其余参数同rdhExtractData
+ */
+rdhStatus rdhExtractDataEx(uint8_t *img1, uint8_t *img2,
+                           int w, int h,
+                           const uint8_t *m, int mSize,
+                           uint8_t **data, int *dataSize,
+                           rdhProgressFun progress, void *arg);
+
 /**
  * \brief 分配空间
  * \param 大小
@@ -118,4 +222,15 @@ void *rdhMalloc(size_t size);
  */
 void rdhFree(void *data);
 
+/**
+ * \brief 设置当前线程的内存分配器, rdhMalloc/rdhFree及内部临时空间都会使用它
+ * \param mallocFun 分配函数, 为NULL时恢复malloc/free
+ * \param freeFun 释放函数
+ * \param arg 分配器参数
+ * \note 在该线程分配的结果必须在同一个分配器下释放
+ */
+void rdhSetAllocator(void *(*mallocFun)(void *arg, size_t size),
+                     void (*freeFun)(void *arg, void *data),
+                     void *arg);
+
 #endif // RDH_H
\ No newline at end of file
@@ -1,8 +1,8 @@
 #include "rand.h"
-static uint8_t xorshift8_state = 1;
-static uint16_t xorshift16_state = 1;
-static uint32_t xorshift32_state = 1;
-static uint64_t xorshift64_state = 1;
+static _Thread_local uint8_t xorshift8_state = 1;
+static _Thread_local uint16_t xorshift16_state = 1;
+static _Thread_local uint32_t xorshift32_state = 1;
+static _Thread_local uint64_t xorshift64_state = 1;
 
 void xSrand8(uint8_t seed)
 {
@@ -16,6 +16,7 @@
 /**
  * \brief 设置Xorshift随机数种子
  * \param seed 随机数种子
+ * \note 随机数状态是线程局部的, 每个线程需要单独设置种子
  */
 void xSrand8(uint8_t seed);
 void xSrand16(uint16_t seed);
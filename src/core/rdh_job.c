@@ -0,0 +1,241 @@
+#include "rdh_job.h"
+#include "trace.h"
+
+struct _rdhJob
+{
+    int type; // 任务类型
+
+    // 输入
+    uint8_t *img1, *img2; // 图像份额
+    int w, h;             // 图像大小
+    const uint8_t *in;    // 嵌入的数据或额外数据m
+    int inSize;           // 输入大小
+
+    // 输出
+    uint8_t *out;     // 嵌入任务为m, 提取任务为数据
+    int outSize;      // 输出大小
+    rdhStatus status; // 状态码
+    rdhStats stats;   // 嵌入任务的统计信息
+
+    // 进度
+    atomic_int blocks;  // 已处理的块数
+    atomic_int bits;    // 已处理的bit数
+    int blocksTotal;    // 块总数
+    atomic_bool cancel; // 取消标志
+    atomic_bool done;   // 结束标志
+
+    // 回调
+    rdhJobFun fun; // 进度回调
+    void *arg;     // 回调参数
+
+    // 线程
+    pthread_t tid;        // 线程ID
+    bool joined;          // 线程是否已回收
+    pthread_mutex_t lock; // 互斥锁, 保护joined
+};
+
+/**
+ * \brief 填充进度
+ */
+static void rdhJobFillInfo(rdhJob *job, rdhJobInfo *info)
+{
+    info->type = job->type;
+    info->blocks = atomic_load_explicit(&job->blocks, memory_order_relaxed);
+    info->blocksTotal = job->blocksTotal;
+    info->bits = atomic_load_explicit(&job->bits, memory_order_relaxed);
+    info->done = atomic_load_explicit(&job->done, memory_order_acquire);
+    info->status = info->done ? job->status : RDH_SUCESS;
+}
+
+/**
+ * \brief RDH进度回调, 更新进度并检查取消标志
+ */
+static bool rdhJobProgress(void *arg, int blocks, int bits)
+{
+    rdhJob *job = (rdhJob *)arg;
+
+    atomic_store_explicit(&job->blocks, blocks, memory_order_relaxed);
+    atomic_store_explicit(&job->bits, bits, memory_order_relaxed);
+
+    if (job->fun)
+    {
+        rdhJobInfo info;
+        rdhJobFillInfo(job, &info);
+        job->fun(job, &info, job->arg);
+    }
+
+    return atomic_load_explicit(&job->cancel, memory_order_relaxed) == false;
+}
+
+/**
+ * \brief 任务线程
+ */
+static void *rdhJobThread(void *arg)
+{
+    rdhJob *job = (rdhJob *)arg;
+    TRACE_THREAD_NAME("rdhJob");
+
+    if (job->type == RDH_JOB_EMBED)
+        job->status = rdhEmbedDataEx(job->img1, job->img2, job->w, job->h,
+                                     &job->out, &job->outSize,
+                                     job->in, job->inSize,
+                                     &job->stats,
+                                     rdhJobProgress, job);
+    else
+        job->status = rdhExtractDataEx(job->img1, job->img2, job->w, job->h,
+                                       job->in, job->inSize,
+                                       &job->out, &job->outSize,
+                                       rdhJobProgress, job);
+
+    // 发布结果
+    atomic_store_explicit(&job->done, true, memory_order_release);
+
+    // 报告结束
+    if (job->fun)
+    {
+        rdhJobInfo info;
+        rdhJobFillInfo(job, &info);
+        job->fun(job, &info, job->arg);
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief 创建并启动任务
+ */
+static rdhJob *rdhJobStart(int type,
+                           uint8_t *img1, uint8_t *img2,
+                           int w, int h,
+                           const uint8_t *in, int inSize,
+                           rdhJobFun fun, void *arg)
+{
+    if (img1 == NULL || img2 == NULL || in == NULL || w < 3 || h < 3)
+        return NULL;
+
+    rdhJob *job = (rdhJob *)malloc(sizeof(rdhJob));
+    if (job == NULL)
+        return NULL;
+    memset(job, 0, sizeof(rdhJob));
+
+    job->type = type;
+    job->img1 = img1;
+    job->img2 = img2;
+    job->w = w;
+    job->h = h;
+    job->in = in;
+    job->inSize = inSize;
+    job->status = RDH_ERROR;
+    job->blocksTotal = (w / 3) * (h / 3);
+    job->fun = fun;
+    job->arg = arg;
+
+    atomic_init(&job->blocks, 0);
+    atomic_init(&job->bits, 0);
+    atomic_init(&job->cancel, false);
+    atomic_init(&job->done, false);
+
+    pthread_mutex_init(&job->lock, NULL);
+    if (pthread_create(&job->tid, NULL, rdhJobThread, job) != 0)
+    {
+        pthread_mutex_destroy(&job->lock);
+        free(job);
+        return NULL;
+    }
+
+    return job;
+}
+
+rdhJob *rdhJobEmbed(uint8_t *img1, uint8_t *img2,
+                    int w, int h,
+                    const uint8_t *data, int size,
+                    rdhJobFun fun, void *arg)
+{
+    return rdhJobStart(RDH_JOB_EMBED, img1, img2, w, h, data, size, fun, arg);
+}
+
+rdhJob *rdhJobExtract(uint8_t *img1, uint8_t *img2,
+                      int w, int h,
+                      const uint8_t *m, int mSize,
+                      rdhJobFun fun, void *arg)
+{
+    return rdhJobStart(RDH_JOB_EXTRACT, img1, img2, w, h, m, mSize, fun, arg);
+}
+
+void rdhJobCancel(rdhJob *job)
+{
+    if (job == NULL)
+        return;
+
+    atomic_store_explicit(&job->cancel, true, memory_order_relaxed);
+}
+
+bool rdhJobPoll(rdhJob *job, rdhJobInfo *info)
+{
+    if (job == NULL)
+        return true;
+
+    if (info)
+        rdhJobFillInfo(job, info);
+
+    return atomic_load_explicit(&job->done, memory_order_acquire);
+}
+
+rdhStatus rdhJobWait(rdhJob *job)
+{
+    if (job == NULL)
+        return RDH_ERROR;
+
+    // 回收线程, 只回收一次
+    pthread_mutex_lock(&job->lock);
+    if (job->joined == false)
+    {
+        pthread_join(job->tid, NULL);
+        job->joined = true;
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    return job->status;
+}
+
+rdhStatus rdhJobResult(rdhJob *job, uint8_t **out, int *outSize)
+{
+    if (job == NULL || rdhJobPoll(job, NULL) == false || job->status != RDH_SUCESS)
+        return RDH_ERROR;
+
+    if (out)
+    {
+        *out = job->out;
+        job->out = NULL;
+    }
+    if (outSize)
+        *outSize = job->outSize;
+
+    return RDH_SUCESS;
+}
+
+rdhStatus rdhJobStats(rdhJob *job, rdhStats *stats)
+{
+    if (job == NULL || job->type != RDH_JOB_EMBED || rdhJobPoll(job, NULL) == false)
+        return RDH_ERROR;
+
+    *stats = job->stats;
+    return RDH_SUCESS;
+}
+
+void rdhJobDestroy(rdhJob *job)
+{
+    if (job == NULL)
+        return;
+
+    // 取消并等待结束
+    rdhJobCancel(job);
+    rdhJobWait(job);
+
+    // 释放未取出的结果
+    if (job->out)
+        rdhFree(job->out);
+
+    pthread_mutex_destroy(&job->lock);
+    free(job);
+}
@@ -0,0 +1,139 @@
+/**
+ * \file rdh_job.h
+ * \brief RDH 异步任务
+ *
+ * // 提交嵌入任务, 任务在后台线程运行
+ * rdhJob *job = rdhJobEmbed(img1, img2, w, h, data, size, NULL, NULL);
+ *
+ * // 轮询进度
+ * rdhJobInfo info;
+ * while (rdhJobPoll(job, &info) == false)
+ *     ...
+ *
+ * // 取消(图像保持不变)或等待结果
+ * rdhJobCancel(job);
+ * if (rdhJobWait(job) == RDH_SUCESS)
+ *     rdhJobResult(job, &m, &mSize);
+ *
+ * // 释放任务
+ * rdhJobDestroy(job);
+ */
+#ifndef RDH_JOB_H
+#define RDH_JOB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "RDH.h"
+
+// 任务类型
+enum
+{
+    RDH_JOB_EMBED,
+    RDH_JOB_EXTRACT
+};
+
+/**
+ * \brief 任务进度
+ */
+typedef struct
+{
+    int type;         // 任务类型
+    int blocks;       // 已处理的块数
+    int blocksTotal;  // 块总数
+    int bits;         // 已嵌入或提取的bit数
+    bool done;        // 是否结束
+    rdhStatus status; // 结束时的状态码
+} rdhJobInfo;
+
+typedef struct _rdhJob rdhJob;
+
+/**
+ * \brief 进度回调, 在任务线程中调用
+ * \param job 任务
+ * \param info 当前进度
+ * \param arg 用户参数
+ */
+typedef void (*rdhJobFun)(rdhJob *job, const rdhJobInfo *info, void *arg);
+
+/**
+ * \brief 提交嵌入任务
+ * \param img1 图像份额1(任务结束前必须有效)
+ * \param img2 图像份额2(任务结束前必须有效)
+ * \param w 宽度
+ * \param h 高度
+ * \param data 数据(任务结束前必须有效)
+ * \param size 数据大小
+ * \param fun 进度回调, 可以为NULL
+ * \param arg 回调参数
+ * \return 任务, 失败返回NULL
+ */
+rdhJob *rdhJobEmbed(uint8_t *img1, uint8_t *img2,
+                    int w, int h,
+                    const uint8_t *data, int size,
+                    rdhJobFun fun, void *arg);
+
+/**
+ * \brief 提交提取任务
+ * \param img1 图像份额1(任务结束前必须有效)
+ * \param img2 图像份额2(任务结束前必须有效)
+ * \param w 宽度
+ * \param h 高度
+ * \param m 额外数据(任务结束前必须有效)
+ * \param mSize 额外数据大小
+ * \param fun 进度回调, 可以为NULL
+ * \param arg 回调参数
+ * \return 任务, 失败返回NULL
+ */
+rdhJob *rdhJobExtract(uint8_t *img1, uint8_t *img2,
+                      int w, int h,
+                      const uint8_t *m, int mSize,
+                      rdhJobFun fun, void *arg);
+
+/**
+ * \brief 请求取消任务, 任务会在处理完当前列后回滚并结束
+ * \param job 任务
+ */
+void rdhJobCancel(rdhJob *job);
+
+/**
+ * \brief 获取任务进度
+ * \param job 任务
+ * \param info 进度, 可以为NULL
+ * \return 任务是否结束
+ */
+bool rdhJobPoll(rdhJob *job, rdhJobInfo *info);
+
+/**
+ * \brief 等待任务结束
+ * \param job 任务
+ * \return 状态码, 被取消时返回RDH_CANCEL
+ */
+rdhStatus rdhJobWait(rdhJob *job);
+
+/**
+ * \brief 取出任务结果, 结果的所有权转移给调用者(使用rdhFree释放)
+ * \param job 任务
+ * \param out 嵌入任务为额外数据m, 提取任务为提取的数据
+ * \param outSize 结果大小
+ * \return 状态码, 任务未成功结束时返回错误
+ */
+rdhStatus rdhJobResult(rdhJob *job, uint8_t **out, int *outSize);
+
+/**
+ * \brief 获取嵌入任务的统计信息
+ * \param job 任务
+ * \param stats 统计信息
+ * \return 状态码, 任务未结束或不是嵌入任务时返回错误
+ */
+rdhStatus rdhJobStats(rdhJob *job, rdhStats *stats);
+
+/**
+ * \brief 释放任务, 若任务仍在运行则取消并等待其结束
+ * \param job 任务
+ */
+void rdhJobDestroy(rdhJob *job);
+
+#endif // RDH_JOB_H
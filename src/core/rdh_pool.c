@@ -0,0 +1,201 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include "rdh_pool.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// 线程池最大线程数
+#define RDH_POOL_THREADS_MAX 256
+
+typedef struct _rdhPoolTask rdhPoolTask;
+typedef struct _rdhPoolTask
+{
+    void (*fun)(int worker, void *arg); // 任务函数
+    void *arg;                          // 任务参数
+    rdhPoolTask *next;                  // 下一个任务
+} rdhPoolTask;
+
+typedef struct
+{
+    rdhPool *pool; // 所属线程池
+    int index;     // 线程序号
+    pthread_t tid; // 线程ID
+} rdhPoolWorker;
+
+struct _rdhPool
+{
+    rdhPoolTask *head; // 任务队列头
+    rdhPoolTask *tail; // 任务队列尾
+    int pending;       // 未完成的任务数(包括正在执行的)
+    bool quit;         // 退出标志
+
+    pthread_mutex_t lock; // 互斥锁
+    pthread_cond_t wake;  // 有新任务或退出
+    pthread_cond_t idle;  // 任务全部完成
+
+    int threads;            // 线程数量
+    rdhPoolWorker *workers; // 工作线程
+};
+
+static void *rdhPoolThread(void *arg)
+{
+    rdhPoolWorker *worker = (rdhPoolWorker *)arg;
+    rdhPool *pool = worker->pool;
+    TRACE_THREAD_NAME("rdhPool");
+
+    pthread_mutex_lock(&pool->lock);
+    while (true)
+    {
+        // 等待任务
+        while (pool->head == NULL && pool->quit == false)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->head == NULL && pool->quit == true)
+            break;
+
+        // 取出任务
+        rdhPoolTask *task = pool->head;
+        pool->head = task->next;
+        if (pool->head == NULL)
+            pool->tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        // 执行任务
+        {
+            TRACE_ZONE("rdhPoolTask");
+            task->fun(worker->index, task->arg);
+        }
+        free(task);
+
+        // 通知等待者
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0)
+            pthread_cond_broadcast(&pool->idle);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+rdhPool *rdhPoolCreate(int threads)
+{
+    if (threads <= 0)
+        threads = rdhPoolCPUCount();
+    if (threads > RDH_POOL_THREADS_MAX)
+        threads = RDH_POOL_THREADS_MAX;
+
+    rdhPool *pool = (rdhPool *)malloc(sizeof(rdhPool));
+    if (pool == NULL)
+        return NULL;
+    memset(pool, 0, sizeof(rdhPool));
+
+    pool->workers = (rdhPoolWorker *)malloc(sizeof(rdhPoolWorker) * threads);
+    if (pool->workers == NULL)
+    {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    // 启动工作线程
+    for (int i = 0; i < threads; i++)
+    {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        if (pthread_create(&pool->workers[i].tid, NULL, rdhPoolThread, &pool->workers[i]) != 0)
+            break;
+        pool->threads++;
+    }
+
+    if (pool->threads == 0)
+    {
+        rdhPoolDestroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+int rdhPoolThreads(rdhPool *pool)
+{
+    return pool ? pool->threads : 0;
+}
+
+bool rdhPoolSubmit(rdhPool *pool, void (*fun)(int worker, void *arg), void *arg)
+{
+    if (pool == NULL || fun == NULL)
+        return false;
+
+    rdhPoolTask *task = (rdhPoolTask *)malloc(sizeof(rdhPoolTask));
+    if (task == NULL)
+        return false;
+    task->fun = fun;
+    task->arg = arg;
+    task->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail)
+        pool->tail->next = task;
+    else
+        pool->head = task;
+    pool->tail = task;
+    pool->pending++;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    return true;
+}
+
+void rdhPoolWait(rdhPool *pool)
+{
+    if (pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0)
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void rdhPoolDestroy(rdhPool *pool)
+{
+    if (pool == NULL)
+        return;
+
+    // 通知线程退出, 已提交的任务会先执行完
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->threads; i++)
+        pthread_join(pool->workers[i].tid, NULL);
+
+    pthread_cond_destroy(&pool->idle);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+int rdhPoolCPUCount(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
@@ -0,0 +1,65 @@
+/**
+ * \file rdh_pool.h
+ * \brief RDH 工作线程池
+ *
+ * // 创建4个工作线程
+ * rdhPool *pool = rdhPoolCreate(4);
+ *
+ * // 提交任务
+ * rdhPoolSubmit(pool, fun, arg);
+ *
+ * // 等待所有任务完成
+ * rdhPoolWait(pool);
+ *
+ * // 销毁线程池
+ * rdhPoolDestroy(pool);
+ */
+#ifndef RDH_POOL_H
+#define RDH_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+typedef struct _rdhPool rdhPool;
+
+/**
+ * \brief 创建线程池
+ * \param threads 线程数量, 小于等于0时使用CPU核心数
+ * \return 线程池, 失败返回NULL
+ */
+rdhPool *rdhPoolCreate(int threads);
+
+/**
+ * \brief 获取线程数量
+ * \param pool 线程池
+ */
+int rdhPoolThreads(rdhPool *pool);
+
+/**
+ * \brief 提交任务
+ * \param pool 线程池
+ * \param fun 任务函数, 参数为工作线程序号和任务参数
+ * \param arg 任务参数
+ * \return 是否提交成功
+ */
+bool rdhPoolSubmit(rdhPool *pool, void (*fun)(int worker, void *arg), void *arg);
+
+/**
+ * \brief 等待已提交的任务全部完成
+ * \param pool 线程池
+ */
+void rdhPoolWait(rdhPool *pool);
+
+/**
+ * \brief 等待任务完成并销毁线程池
+ * \param pool 线程池
+ */
+void rdhPoolDestroy(rdhPool *pool);
+
+/**
+ * \brief 获取CPU核心数
+ */
+int rdhPoolCPUCount(void);
+
+#endif // RDH_POOL_H
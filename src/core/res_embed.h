@@ -0,0 +1,27 @@
+/**
+ * \file res_embed.h
+ * \brief 编译进程序的资源文件, 由cmake/embed.cmake在构建时生成
+ *
+ * 文件列表由CMake缓存变量MIE_EMBED_FILES指定, resInit时注册到资源缓存,
+ * 之后resGetFile直接返回数组, 不需要读取文件
+ */
+#ifndef RES_EMBED_H
+#define RES_EMBED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \brief 编译进程序的文件
+ */
+typedef struct
+{
+    const char *name;    // 文件名
+    const uint8_t *data; // 数据, 结尾有一个0
+    size_t size;         // 大小(不包括结尾的0)
+} resEmbedFile;
+
+extern const resEmbedFile resEmbedFiles[]; // 文件列表
+extern const int resEmbedCount;            // 文件数量
+
+#endif // RES_EMBED_H
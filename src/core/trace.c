@@ -0,0 +1,235 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include "trace.h"
+
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+uint64_t traceNow(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)(now.QuadPart / freq.QuadPart) * 1000000000ULL +
+           (uint64_t)(now.QuadPart % freq.QuadPart) * 1000000000ULL / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+#ifdef MIE_TRACE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define TRACE_NAME_MAX 32    // 线程名称的最大长度
+#define TRACE_THREAD_MAX 256 // 记录名称的最大线程数
+
+/**
+ * \brief 事件, 在区间结束时记录
+ */
+typedef struct
+{
+    const char *name; // 名称
+    uint64_t start;   // 开始时间(ns)
+    uint64_t end;     // 结束时间(ns)
+    uint32_t tid;     // 线程号
+} traceEvent;
+
+/**
+ * \brief 线程的环形缓冲区, 只有所属线程写入
+ * \note 线程结束后缓冲区留给之后的线程复用, 旧事件保留到被覆盖为止
+ */
+typedef struct _traceRing
+{
+    traceEvent events[TRACE_RING_SIZE]; // 事件
+    _Atomic uint64_t head;              // 已写入的事件总数
+    atomic_bool used;                   // 是否属于某个线程
+    uint32_t tid;                       // 当前线程号
+    struct _traceRing *next;            // 下一个缓冲区
+} traceRing;
+
+static pthread_once_t traceOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t traceKey;                                 // 线程结束时归还缓冲区
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER; // 保护缓冲区链表和线程名称
+static traceRing *traceRings = NULL;                           // 所有缓冲区
+static uint32_t traceTid = 0;                                  // 已分配的线程号
+static _Thread_local traceRing *traceLocal = NULL;             // 当前线程的缓冲区
+
+// 线程名称
+static struct
+{
+    uint32_t tid;
+    char name[TRACE_NAME_MAX];
+} traceThreads[TRACE_THREAD_MAX];
+static int traceThreadCount = 0;
+
+static void traceRingRelease(void *arg)
+{
+    traceRing *ring = (traceRing *)arg;
+    atomic_store_explicit(&ring->used, false, memory_order_release);
+}
+
+static void traceKeyInit(void)
+{
+    pthread_key_create(&traceKey, traceRingRelease);
+}
+
+/**
+ * \brief 获取当前线程的缓冲区, 第一次调用时分配或复用空闲的缓冲区
+ */
+static traceRing *traceRingGet(void)
+{
+    if (traceLocal)
+        return traceLocal;
+
+    pthread_once(&traceOnce, traceKeyInit);
+    pthread_mutex_lock(&traceLock);
+
+    traceRing *ring = traceRings;
+    while (ring && atomic_load_explicit(&ring->used, memory_order_acquire))
+        ring = ring->next;
+    if (ring == NULL)
+    {
+        ring = (traceRing *)calloc(1, sizeof(traceRing));
+        if (ring == NULL)
+        {
+            pthread_mutex_unlock(&traceLock);
+            return NULL;
+        }
+        ring->next = traceRings;
+        traceRings = ring;
+    }
+    atomic_store_explicit(&ring->used, true, memory_order_relaxed);
+    ring->tid = ++traceTid;
+
+    pthread_mutex_unlock(&traceLock);
+
+    pthread_setspecific(traceKey, ring);
+    traceLocal = ring;
+    return ring;
+}
+
+void traceZoneEnd(traceZone *zone)
+{
+    uint64_t end = traceNow();
+    traceRing *ring = traceRingGet();
+    if (ring == NULL)
+        return;
+
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    traceEvent *event = &ring->events[head & (TRACE_RING_SIZE - 1)];
+    event->name = zone->name;
+    event->start = zone->start;
+    event->end = end;
+    event->tid = ring->tid;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void traceSetThreadName(const char *name)
+{
+    traceRing *ring = traceRingGet();
+    if (ring == NULL)
+        return;
+
+    pthread_mutex_lock(&traceLock);
+    if (traceThreadCount < TRACE_THREAD_MAX)
+    {
+        traceThreads[traceThreadCount].tid = ring->tid;
+        strncpy(traceThreads[traceThreadCount].name, name, TRACE_NAME_MAX - 1);
+        traceThreadCount++;
+    }
+    pthread_mutex_unlock(&traceLock);
+}
+
+/**
+ * \brief 输出JSON字符串, 转义引号和反斜杠
+ */
+static void traceWriteString(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for (; *s; s++)
+    {
+        if (*s == '"' || *s == '\\')
+            fputc('\\', fp);
+        if ((unsigned char)*s >= 0x20)
+            fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+bool traceDump(const char *path)
+{
+    if (path == NULL)
+        path = getenv("MIE_TRACE_FILE");
+    if (path == NULL)
+        path = "mie_trace.json";
+
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL)
+        return false;
+
+    pthread_mutex_lock(&traceLock);
+
+    // 以最早的事件为时间零点
+    uint64_t base = UINT64_MAX;
+    for (traceRing *ring = traceRings; ring; ring = ring->next)
+    {
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t count = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+        for (uint64_t i = head - count; i < head; i++)
+            if (ring->events[i & (TRACE_RING_SIZE - 1)].start < base)
+                base = ring->events[i & (TRACE_RING_SIZE - 1)].start;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+
+    // 线程名称
+    for (int i = 0; i < traceThreadCount; i++)
+    {
+        fprintf(fp, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                first ? "" : ",\n", traceThreads[i].tid);
+        traceWriteString(fp, traceThreads[i].name);
+        fprintf(fp, "}}");
+        first = false;
+    }
+
+    // 事件, 时间单位为微秒
+    for (traceRing *ring = traceRings; ring; ring = ring->next)
+    {
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t count = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+        for (uint64_t i = head - count; i < head; i++)
+        {
+            const traceEvent *event = &ring->events[i & (TRACE_RING_SIZE - 1)];
+            if (event->name == NULL || event->end < event->start)
+                continue;
+            fprintf(fp, "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+                    first ? "" : ",\n", event->tid,
+                    (event->start - base) / 1000.0, (event->end - event->start) / 1000.0);
+            traceWriteString(fp, event->name);
+            fputc('}', fp);
+            first = false;
+        }
+    }
+
+    pthread_mutex_unlock(&traceLock);
+
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    return true;
+}
+
+#endif // MIE_TRACE
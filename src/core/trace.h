@@ -0,0 +1,87 @@
+/**
+ * \file trace.h
+ * \brief 性能追踪
+ *
+ * 定义MIE_TRACE(CMake选项 -DMIE_TRACE=ON)时启用, 否则所有宏为空, 不产生任何代码.
+ * 每个线程把事件写入自己的环形缓冲区(无锁, 满了覆盖最旧的事件), 时间戳精确到纳秒,
+ * 最后导出为Chrome/Perfetto可以打开的JSON(chrome://tracing 或 ui.perfetto.dev)
+ *
+ * void fun(void)
+ * {
+ *     TRACE_ZONE("fun"); // 离开作用域时自动结束
+ *     ...
+ * }
+ *
+ * TRACE_BEGIN(zone, "step"); // 不按作用域的区间
+ * ...
+ * TRACE_END(zone);
+ *
+ * TRACE_THREAD_NAME("worker"); // 设置当前线程名称
+ * TRACE_DUMP(NULL);            // 导出到环境变量MIE_TRACE_FILE指定的文件, 默认mie_trace.json
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * \brief 获取单调时间, 不启用追踪时也可以使用
+ * \return 纳秒
+ */
+uint64_t traceNow(void);
+
+#ifdef MIE_TRACE
+
+#define TRACE_RING_SIZE 0x4000 // 每个线程缓冲的事件数量, 必须是2的幂
+
+/**
+ * \brief 追踪区间
+ */
+typedef struct
+{
+    const char *name; // 名称, 必须是常量字符串
+    uint64_t start;   // 开始时间(ns)
+} traceZone;
+
+/**
+ * \brief 结束区间并记录事件
+ * \param zone 区间
+ */
+void traceZoneEnd(traceZone *zone);
+
+/**
+ * \brief 设置当前线程的名称
+ * \param name 名称
+ */
+void traceSetThreadName(const char *name);
+
+/**
+ * \brief 导出所有线程的事件
+ * \param path 文件路径, 为NULL时使用环境变量MIE_TRACE_FILE, 默认mie_trace.json
+ * \return 是否成功
+ * \note 其他线程仍在写入时, 正在被覆盖的事件可能不完整
+ */
+bool traceDump(const char *path);
+
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+
+#define TRACE_ZONE(name) \
+    traceZone TRACE_CAT(traceZone_, __LINE__) __attribute__((cleanup(traceZoneEnd))) = {(name), traceNow()}
+#define TRACE_BEGIN(zone, name) traceZone zone = {(name), traceNow()}
+#define TRACE_END(zone) traceZoneEnd(&(zone))
+#define TRACE_THREAD_NAME(name) traceSetThreadName(name)
+#define TRACE_DUMP(path) traceDump(path)
+
+#else
+
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_BEGIN(zone, name) ((void)0)
+#define TRACE_END(zone) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#define TRACE_DUMP(path) ((void)0)
+
+#endif // MIE_TRACE
+
+#endif // TRACE_H
@@ -0,0 +1,421 @@
+/**
+ * \file mie_daemon.c
+ * \brief 常驻的本地加密服务, 协议见mie_daemon.h
+ *
+ * mie-daemon [-j 线程数] [-s 套接字路径]
+ *
+ * 主线程用poll监听连接, 收到请求后交给常驻线程池处理, 每个工作线程有自己的缓冲区,
+ * 请求之间复用, 像素数据通过共享内存传递, 不复制
+ */
+#define _GNU_SOURCE
+#include <poll.h>
+#include <errno.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+#include "RDH.h"
+#include "rdh_pool.h"
+#include "trace.h"
+#include "mie_daemon.h"
+
+#define MIE_CONN_MAX 64   // 最大连接数
+#define MIE_ARENA_SLOTS 8 // 每个工作线程缓存的缓冲区数量
+
+/**
+ * \brief 工作线程的缓冲区缓存, 作为RDH的分配器, 请求之间复用
+ */
+typedef struct
+{
+    void *ptr;  // 缓冲区
+    size_t cap; // 容量
+    bool used;  // 是否正在使用
+} mieArenaSlot;
+
+typedef struct
+{
+    mieArenaSlot slot[MIE_ARENA_SLOTS];
+} mieArena;
+
+// 连接
+typedef struct
+{
+    int fd;    // 套接字, -1表示空闲
+    bool busy; // 是否有请求正在处理
+} mieConn;
+
+// 请求
+typedef struct
+{
+    int conn;       // 连接序号
+    int fd;         // 连接套接字
+    int shm;        // 共享内存
+    mieRequest req; // 请求头
+} mieJob;
+
+static mieArena *arenas;                // 每个工作线程一个
+static int wakePipe[2];                 // 工作线程通知主线程连接空闲
+static volatile sig_atomic_t quit = 0; // 退出标志
+
+static void *mieArenaMalloc(void *arg, size_t size)
+{
+    mieArena *arena = (mieArena *)arg;
+
+    // 找到足够大且最小的空闲缓冲区
+    int best = -1;
+    for (int i = 0; i < MIE_ARENA_SLOTS; i++)
+    {
+        mieArenaSlot *s = &arena->slot[i];
+        if (s->used == false && s->ptr && s->cap >= size &&
+            (best < 0 || s->cap < arena->slot[best].cap))
+            best = i;
+    }
+    if (best >= 0)
+    {
+        arena->slot[best].used = true;
+        return arena->slot[best].ptr;
+    }
+
+    // 没有合适的缓冲区, 优先使用空槽, 否则替换一个空闲的小缓冲区
+    int spare = -1;
+    for (int i = 0; i < MIE_ARENA_SLOTS; i++)
+    {
+        mieArenaSlot *s = &arena->slot[i];
+        if (s->used == false && (spare < 0 || s->ptr == NULL))
+            spare = i;
+    }
+    if (spare < 0)
+        return malloc(size); // 全部在使用, 不缓存
+
+    mieArenaSlot *s = &arena->slot[spare];
+    free(s->ptr);
+    s->ptr = malloc(size);
+    s->cap = s->ptr ? size : 0;
+    s->used = s->ptr != NULL;
+    return s->ptr;
+}
+
+static void mieArenaFree(void *arg, void *data)
+{
+    mieArena *arena = (mieArena *)arg;
+
+    for (int i = 0; i < MIE_ARENA_SLOTS; i++)
+    {
+        if (arena->slot[i].ptr == data)
+        {
+            arena->slot[i].used = false;
+            return;
+        }
+    }
+    free(data);
+}
+
+/**
+ * \brief 处理请求, 结果写入共享内存
+ * \note 请求已经由mieShmSize检查, w * h不超过INT_MAX
+ */
+static void mieDoRequest(const mieRequest *req, uint8_t *shm, mieResponse *res)
+{
+    int w = req->w, h = req->h;
+    int n = w * h;
+    uint8_t *img1 = shm + MIE_SHM_IMG(w, h, 0);
+    uint8_t *img2 = shm + MIE_SHM_IMG(w, h, 1);
+    uint8_t *data = shm + MIE_SHM_DATA(w, h);
+    uint8_t *out = shm + MIE_SHM_OUT(w, h, req->size);
+
+    res->status = RDH_SUCESS;
+    res->size = 0;
+
+    switch (req->type)
+    {
+    case MIE_REQ_SPLIT:
+        rdhSplitImageTo(img1, n, img2, shm + MIE_SHM_IMG(w, h, 2));
+        break;
+    case MIE_REQ_COMBINE:
+        rdhCombineImageTo(img1, img2, n, shm + MIE_SHM_IMG(w, h, 2));
+        break;
+    case MIE_REQ_EMBED:
+    {
+        // 直接在共享内存中嵌入, m写入输出区域
+        int mSize = 0;
+        res->status = rdhEmbedDataTo(img1, img2, w, h, out, &mSize, data, req->size);
+        res->size = mSize;
+        break;
+    }
+    case MIE_REQ_EXTRACT:
+    {
+        uint8_t *buf = NULL;
+        int size = 0;
+        res->status = rdhExtractDataEx(img1, img2, w, h, data, req->size, &buf, &size, NULL, NULL);
+        if (res->status == RDH_SUCESS)
+        {
+            if ((size_t)size > MIE_DATA_CAP(w, h))
+                size = (int)MIE_DATA_CAP(w, h);
+            memcpy(out, buf, size);
+            res->size = size;
+        }
+        rdhFree(buf);
+        break;
+    }
+    default:
+        res->status = RDH_ERROR;
+        break;
+    }
+}
+
+/**
+ * \brief 工作线程处理一个请求
+ */
+static void mieJobRun(int worker, void *arg)
+{
+    mieJob *job = (mieJob *)arg;
+    mieResponse res = {MIE_DAEMON_MAGIC, RDH_ERROR, 0, 0};
+
+    // 使用本线程的缓冲区
+    rdhSetAllocator(mieArenaMalloc, mieArenaFree, &arenas[worker]);
+
+    // 映射共享内存, 必须已经禁止缩小, 否则客户端截断后访问映射会收到SIGBUS
+    size_t need = mieShmSize(&job->req);
+    int seals = fcntl(job->shm, F_GET_SEALS);
+    struct stat st;
+    if (need != 0 && seals >= 0 && (seals & F_SEAL_SHRINK) &&
+        fstat(job->shm, &st) == 0 && (uint64_t)st.st_size >= need)
+    {
+        uint8_t *shm = (uint8_t *)mmap(NULL, need, PROT_READ | PROT_WRITE, MAP_SHARED, job->shm, 0);
+        if (shm != MAP_FAILED)
+        {
+            mieDoRequest(&job->req, shm, &res);
+            munmap(shm, need);
+        }
+    }
+    close(job->shm);
+
+    // 返回结果并通知主线程连接空闲
+    send(job->fd, &res, sizeof(res), MSG_NOSIGNAL);
+    int ret = write(wakePipe[1], &job->conn, sizeof(job->conn));
+    (void)ret;
+
+    free(job);
+}
+
+/**
+ * \brief 接收请求头和共享内存描述符
+ * \return 是否成功, 失败时应当关闭连接
+ */
+static bool mieRecvRequest(int fd, mieRequest *req, int *shm)
+{
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = {req, sizeof(mieRequest)};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    *shm = -1;
+    ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+
+    // 只保留第一个描述符, 其余的全部关闭(放不下的描述符由内核关闭)
+    for (struct cmsghdr *cmsg = n >= 0 ? CMSG_FIRSTHDR(&msg) : NULL; cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; i++)
+        {
+            int received;
+            memcpy(&received, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            if (*shm < 0)
+                *shm = received;
+            else
+                close(received);
+        }
+    }
+
+    if (n != sizeof(mieRequest) || req->magic != MIE_DAEMON_MAGIC || *shm < 0)
+    {
+        if (*shm >= 0)
+            close(*shm);
+        return false;
+    }
+    return true;
+}
+
+static void mieOnSignal(int sig)
+{
+    (void)sig;
+    quit = 1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = MIE_DAEMON_SOCKET;
+    int threads = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            path = argv[++i];
+        else
+        {
+            fprintf(stderr, "用法: mie-daemon [-j 线程数] [-s 套接字路径]\n");
+            return 1;
+        }
+    }
+
+    // 监听套接字
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "套接字路径过长: %s\n", path);
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // 已有守护进程在监听时不接管它的套接字, 连接失败说明是残留的文件
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0 && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+    {
+        fprintf(stderr, "%s 已有守护进程在监听\n", path);
+        close(probe);
+        return 1;
+    }
+    if (probe >= 0)
+        close(probe);
+    unlink(path);
+
+    // 套接字只允许当前用户连接, 其他用户不能通过守护进程处理图像
+    int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    mode_t mask = umask(077);
+    int bound = server >= 0 ? bind(server, (struct sockaddr *)&addr, sizeof(addr)) : -1;
+    umask(mask);
+    if (server < 0 || bound != 0 ||
+        chmod(path, 0600) != 0 ||
+        listen(server, MIE_CONN_MAX) != 0 ||
+        pipe2(wakePipe, O_CLOEXEC) != 0)
+    {
+        fprintf(stderr, "监听 %s 失败: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    // 常驻线程池和缓冲区
+    srand((unsigned int)time(NULL));
+    rdhPool *pool = rdhPoolCreate(threads);
+    if (pool == NULL)
+    {
+        fprintf(stderr, "创建线程池失败\n");
+        return 1;
+    }
+    arenas = (mieArena *)calloc(rdhPoolThreads(pool), sizeof(mieArena));
+    if (arenas == NULL)
+    {
+        fprintf(stderr, "分配缓冲区失败\n");
+        rdhPoolDestroy(pool);
+        close(server);
+        unlink(path);
+        return 1;
+    }
+
+    struct sigaction sa = {0};
+    sa.sa_handler = mieOnSignal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    fprintf(stderr, "mie-daemon: 监听 %s, %d 个工作线程\n", path, rdhPoolThreads(pool));
+
+    mieConn conns[MIE_CONN_MAX];
+    for (int i = 0; i < MIE_CONN_MAX; i++)
+        conns[i].fd = -1;
+
+    while (quit == 0)
+    {
+        // 监听套接字, 通知管道, 空闲的连接
+        struct pollfd fds[MIE_CONN_MAX + 2];
+        int index[MIE_CONN_MAX + 2];
+        int count = 0;
+        fds[count++] = (struct pollfd){server, POLLIN, 0};
+        fds[count++] = (struct pollfd){wakePipe[0], POLLIN, 0};
+        for (int i = 0; i < MIE_CONN_MAX; i++)
+        {
+            if (conns[i].fd >= 0 && conns[i].busy == false)
+            {
+                index[count] = i;
+                fds[count++] = (struct pollfd){conns[i].fd, POLLIN, 0};
+            }
+        }
+
+        if (poll(fds, count, -1) < 0)
+            continue; // EINTR
+
+        // 新连接
+        if (fds[0].revents & POLLIN)
+        {
+            int fd = accept4(server, NULL, NULL, SOCK_CLOEXEC);
+            int slot = -1;
+            for (int i = 0; i < MIE_CONN_MAX && fd >= 0 && slot < 0; i++)
+                if (conns[i].fd < 0)
+                    slot = i;
+            if (slot >= 0)
+                conns[slot] = (mieConn){fd, false};
+            else if (fd >= 0)
+                close(fd);
+        }
+
+        // 处理完成的连接
+        if (fds[1].revents & POLLIN)
+        {
+            int ids[MIE_CONN_MAX];
+            ssize_t n = read(wakePipe[0], ids, sizeof(ids));
+            for (int i = 0; i < n / (ssize_t)sizeof(int); i++)
+                conns[ids[i]].busy = false;
+        }
+
+        // 新请求
+        for (int i = 2; i < count; i++)
+        {
+            if (fds[i].revents == 0)
+                continue;
+
+            mieConn *conn = &conns[index[i]];
+            mieJob *job = (mieJob *)malloc(sizeof(mieJob));
+            if (job == NULL || mieRecvRequest(conn->fd, &job->req, &job->shm) == false)
+            {
+                free(job);
+                close(conn->fd);
+                conn->fd = -1;
+                continue;
+            }
+
+            job->conn = index[i];
+            job->fd = conn->fd;
+            conn->busy = true;
+            rdhPoolSubmit(pool, mieJobRun, job);
+        }
+    }
+
+    // 等待正在处理的请求
+    int workers = rdhPoolThreads(pool);
+    rdhPoolDestroy(pool);
+    for (int i = 0; i < workers; i++)
+        for (int j = 0; j < MIE_ARENA_SLOTS; j++)
+            free(arenas[i].slot[j].ptr);
+    free(arenas);
+    for (int i = 0; i < MIE_CONN_MAX; i++)
+        if (conns[i].fd >= 0)
+            close(conns[i].fd);
+    close(server);
+    unlink(path);
+    TRACE_DUMP(NULL);
+
+    return 0;
+}
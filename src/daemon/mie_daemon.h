@@ -0,0 +1,105 @@
+/**
+ * \file mie_daemon.h
+ * \brief mie-daemon 通信协议
+ *
+ * 客户端通过Unix域套接字发送mieRequest, 并用SCM_RIGHTS附带一个共享内存的文件描述符,
+ * 像素数据全部放在共享内存中, 守护进程直接在其中读写, 处理完成后返回mieResponse.
+ * 一个连接上可以顺序发送多个请求
+ *
+ * 除EXTRACT的提取数据外都不经过中间缓冲区. EMBED直接修改份额, 失败时份额可能已被部分修改;
+ * EXTRACT恢复份额时同样原地进行, 提取的数据先写入守护进程的缓冲区, 再复制到共享内存
+ *
+ * 共享内存必须由memfd_create(MFD_ALLOW_SEALING)创建, 并在发送前加上F_SEAL_SHRINK,
+ * 否则处理过程中被截断会使守护进程访问映射时收到SIGBUS, 没有该封印的请求会被拒绝
+ *
+ * 共享内存布局(n = w * h):
+ *     SPLIT   : [图像 n][份额1 n][份额2 n]                      写入两个份额
+ *     COMBINE : [份额1 n][份额2 n][图像 n]                      写入图像
+ *     EMBED   : [份额1 n][份额2 n][数据 size][m MIE_M_CAP]       原地嵌入份额, 写入m
+ *     EXTRACT : [份额1 n][份额2 n][m size][数据 MIE_DATA_CAP]    原地恢复份额, 写入数据
+ */
+#ifndef MIE_DAEMON_H
+#define MIE_DAEMON_H
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MIE_DAEMON_SOCKET "/tmp/mie-daemon.sock" // 默认套接字路径
+#define MIE_DAEMON_MAGIC 0x3145494D              // "MIE1"
+
+// 请求类型
+enum
+{
+    MIE_REQ_SPLIT = 1,
+    MIE_REQ_COMBINE,
+    MIE_REQ_EMBED,
+    MIE_REQ_EXTRACT
+};
+
+// 额外数据m和提取数据的最大大小
+#define MIE_M_CAP(w, h) ((size_t)((w) / 3) * (size_t)((h) / 3))
+#define MIE_DATA_CAP(w, h) ((MIE_M_CAP(w, h) * 9 + 7) / 8 + 0x20)
+
+// 共享内存中各部分的偏移
+#define MIE_SHM_IMG(w, h, i) ((size_t)(w) * (size_t)(h) * (size_t)(i)) // 第i张图像
+#define MIE_SHM_DATA(w, h) MIE_SHM_IMG(w, h, 2)                        // EMBED的数据, EXTRACT的m
+#define MIE_SHM_OUT(w, h, size) (MIE_SHM_DATA(w, h) + (size_t)(size))  // EMBED的m, EXTRACT的数据
+
+typedef struct
+{
+    uint32_t magic; // MIE_DAEMON_MAGIC
+    uint32_t type;  // 请求类型
+    int32_t w;      // 图像宽度
+    int32_t h;      // 图像高度
+    int32_t size;   // EMBED为数据大小, EXTRACT为m大小
+    int32_t rsv;    // 保留
+} mieRequest;
+
+typedef struct
+{
+    uint32_t magic; // MIE_DAEMON_MAGIC
+    int32_t status; // RDH状态码
+    int32_t size;   // EMBED为m大小, EXTRACT为提取的数据大小
+    int32_t rsv;    // 保留
+} mieResponse;
+
+/**
+ * \brief 计算请求需要的共享内存大小
+ * \param req 请求
+ * \return 大小, 请求无效时返回0
+ * \note 像素数量超过INT_MAX(RDH接口使用int), 各部分的偏移超出size_t,
+ *       EMBED的数据超过图像能嵌入的最大大小或EXTRACT的m超过MIE_M_CAP时请求无效
+ */
+static inline size_t mieShmSize(const mieRequest *req)
+{
+    if (req->w < 3 || req->h < 3 || req->size < 0)
+        return 0;
+
+    // 各种请求的大小都不超过4n + size
+    if ((int64_t)req->w * req->h > INT_MAX)
+        return 0;
+    size_t n = (size_t)req->w * (size_t)req->h;
+    if (n > (SIZE_MAX - (size_t)req->size) / 4)
+        return 0;
+
+    switch (req->type)
+    {
+    case MIE_REQ_SPLIT:
+    case MIE_REQ_COMBINE:
+        return MIE_SHM_IMG(req->w, req->h, 3);
+    case MIE_REQ_EMBED:
+        // INT_MAX / 8即RDH_DATA_SIZE_MAX, 超过时转换为bit数会溢出
+        if (req->size > INT_MAX / 8 || (size_t)req->size > MIE_DATA_CAP(req->w, req->h))
+            return 0;
+        return MIE_SHM_OUT(req->w, req->h, req->size) + MIE_M_CAP(req->w, req->h);
+    case MIE_REQ_EXTRACT:
+        if ((size_t)req->size > MIE_M_CAP(req->w, req->h))
+            return 0;
+        return MIE_SHM_OUT(req->w, req->h, req->size) + MIE_DATA_CAP(req->w, req->h);
+    default:
+        return 0;
+    }
+}
+
+#endif // MIE_DAEMON_H
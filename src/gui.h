@@ -24,6 +24,7 @@
 #include "gui_widgetID.h"
 
 #include "gui_widget_mousemove.h"
+#include "gui_widget_hud.h"
 
 #define WINDOW_WIDTH 1000
 #define WINDOW_HEIGHT 618
@@ -1,87 +1,190 @@
 #include "gui_frame.h"
 
-void guiFrameControl(GUIFrame *param)
+static int guiFrameCompare(const void *a, const void *b)
 {
-    double start = glfwGetTime();
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * \brief 不考虑错过截止时间时的帧率上限: 设置的帧率和未结束的请求中较高的
+ */
+static int guiFrameCeiling(const GUIFrame *frame, double now)
+{
+    if (frame->requestUntil > now && frame->requestRate > frame->rateMax)
+        return frame->requestRate;
+    return frame->rateMax;
+}
+
+/**
+ * \brief 当前应使用的帧率
+ */
+static int guiFrameTarget(const GUIFrame *frame, double now)
+{
+    int ceiling = guiFrameCeiling(frame, now);
+    return frame->rateLimit && frame->rateLimit < ceiling ? frame->rateLimit : ceiling;
+}
+
+void guiFrameInit(GUIFrame *frame, int frameRate, bool vsync)
+{
+    memset(frame, 0, sizeof(GUIFrame));
+    frame->vsync = vsync;
+    guiFrameSet(frame, frameRate);
+
+    // 垂直同步时交换缓冲区会等待显示器刷新, 帧率不会超过刷新率
+    glfwSwapInterval(vsync ? 1 : 0);
+    frame->deadline = glfwGetTime();
+}
 
-    pthread_mutex_lock(&param->lock);
-    while (0 != sem_trywait(&param->semQuit))
+void guiFrameSet(GUIFrame *frame, int frameRate)
+{
+    frame->rateMax = frameRate > GUI_FRAME_RATE_MIN ? frameRate : GUI_FRAME_RATE_MIN;
+    frame->rateLimit = 0;
+    frame->rate = guiFrameTarget(frame, glfwGetTime());
+}
+
+void guiFrameRequest(GUIFrame *frame, int frameRate, double until)
+{
+    double now = glfwGetTime();
+    if (until <= now)
+        return;
+
+    // 与未结束的请求合并
+    if (frame->requestUntil > now)
     {
-        double intervalTime = glfwGetTime() - start;
-
-        if (intervalTime < param->frameRate)
-        {
-            pthread_mutex_unlock(&param->lock);
-
-            // 抛出空事件
-            glfwPostEmptyEvent();
-
-            // 发送信号
-            sem_post(&param->semWait);
-
-            // 等待事件
-            struct timespec ts;
-            ts.tv_sec = 0;
-            ts.tv_nsec = (long)((param->frameRate - intervalTime) * 1e9);
-            nanosleep(&ts, NULL);
-
-            pthread_mutex_lock(&param->lock);
-        }
-
-        // 更新开始时间
-        start += param->frameRate;
-
-        // 如果实际时间超过了预期时间，调整开始时间
-        double checkTime = glfwGetTime() - start - param->frameRate;
-        if (checkTime > 0)
-        {
-            start += checkTime;
-        }
-        // while (glfwGetTime() - start > param->frameRate)
-        // {
-        //     start += param->frameRate;
-        // }
+        frame->requestRate = frameRate > frame->requestRate ? frameRate : frame->requestRate;
+        frame->requestUntil = until > frame->requestUntil ? until : frame->requestUntil;
+    }
+    else
+    {
+        frame->requestRate = frameRate;
+        frame->requestUntil = until;
+    }
+
+    // 帧率提高时提前下一帧的截止时间, 不必等到按原帧率计算的截止时间
+    int rate = guiFrameTarget(frame, now);
+    if (rate > frame->rate)
+    {
+        frame->rate = rate;
+        double next = frame->begin + 1.0 / rate;
+        if (frame->deadline > next)
+            frame->deadline = next > now ? next : now;
     }
-    pthread_mutex_unlock(&param->lock);
 }
 
-GUIFrame *guiFrameCreate(int frameRate)
+void guiFrameWait(GUIFrame *frame, bool dirty, bool busy)
 {
-    GUIFrame *param = (GUIFrame *)malloc(sizeof(GUIFrame));
-    if (param == NULL)
+    // 有后台任务时只处理已有的事件
+    if (busy)
+    {
+        glfwPollEvents();
+        return;
+    }
+
+    // 没有需要重绘的内容时一直等待, 没有任何唤醒
+    if (dirty == false)
     {
-        return NULL;
+        glfwWaitEvents();
+        return;
     }
 
-    param->frameRate = 1.0 / frameRate;
+    // 等到截止时间, 期间的事件会提前唤醒
+    double wait = frame->deadline - glfwGetTime();
+    if (wait > 0)
+        glfwWaitEventsTimeout(wait);
+    else
+        glfwPollEvents();
+}
+
+bool guiFrameCheck(GUIFrame *frame, bool dirty)
+{
+    return dirty && glfwGetTime() >= frame->deadline;
+}
+
+void guiFrameBegin(GUIFrame *frame)
+{
+    frame->begin = glfwGetTime();
+
+    // 请求结束后回到设置的帧率
+    frame->rate = guiFrameTarget(frame, frame->begin);
+
+    // 按截止时间推进, 空闲之后从当前时间重新开始
+    double interval = 1.0 / frame->rate;
+    frame->deadline += interval;
+    if (frame->deadline < frame->begin)
+        frame->deadline = frame->begin + interval;
+}
+
+/**
+ * \brief 每隔GUI_FRAME_ADAPT帧调整帧率
+ *
+ * 超过10%的帧错过截止时间时帧率上限减半, 没有错过并且耗时足够完成更高的帧率时上限加倍,
+ * 达到设置或请求的帧率时取消限制
+ */
+static void guiFrameAdapt(GUIFrame *frame)
+{
+    if (frame->adaptFrames < GUI_FRAME_ADAPT)
+        return;
 
-    pthread_mutex_init(&param->lock, NULL);
-    sem_init(&param->semWait, 0, 0);
-    sem_init(&param->semQuit, 0, 0);
+    GUIframeStats stats;
+    guiFrameGetStats(frame, &stats);
 
-    pthread_create(&param->guiFrameTID, NULL, (void *(*)(void *))guiFrameControl, param);
+    int rate = frame->rate;
+    if (frame->adaptMissed * 10 > frame->adaptFrames)
+    {
+        rate = rate / 2 > GUI_FRAME_RATE_MIN ? rate / 2 : GUI_FRAME_RATE_MIN;
+        frame->rateLimit = rate;
+    }
+    else if (frame->adaptMissed == 0 && frame->rateLimit && stats.p99 < 0.8 / (rate * 2))
+    {
+        frame->rateLimit = rate * 2;
+        if (frame->rateLimit >= guiFrameCeiling(frame, glfwGetTime()))
+            frame->rateLimit = 0;
+        rate = guiFrameTarget(frame, glfwGetTime());
+    }
 
-    return param;
+    if (rate != frame->rate)
+    {
+        DEBUG("帧率调整: %d -> %d (p50 %.2fms, p99 %.2fms)\n", frame->rate, rate, stats.p50 * 1000, stats.p99 * 1000);
+        frame->rate = rate;
+    }
+    frame->adaptFrames = 0;
+    frame->adaptMissed = 0;
 }
 
-void guiFrameDestroy(GUIFrame *param)
+void guiFrameEnd(GUIFrame *frame)
 {
-    // 通知线程退出
-    sem_post(&param->semQuit);
+    double time = glfwGetTime() - frame->begin;
+
+    // 记录帧耗时
+    frame->samples[frame->frames % GUI_FRAME_SAMPLES] = (float)time;
+    if (frame->sampleCount < GUI_FRAME_SAMPLES)
+        frame->sampleCount++;
+    frame->frames++;
+    frame->adaptFrames++;
 
-    // 等待线程退出
-    pthread_join(param->guiFrameTID, NULL);
+    // 耗时超过帧间隔时一定错过了下一帧的截止时间
+    if (time > 1.0 / frame->rate)
+    {
+        frame->missed++;
+        frame->adaptMissed++;
+    }
 
-    // 释放资源
-    sem_destroy(&param->semWait);
-    sem_destroy(&param->semQuit);
-    pthread_mutex_destroy(&param->lock);
-    free(param);
+    guiFrameAdapt(frame);
 }
 
-void guiFrameSet(GUIFrame *param, int frameRate)
+void guiFrameGetStats(const GUIFrame *frame, GUIframeStats *stats)
 {
-    pthread_mutex_lock(&param->lock);
-    param->frameRate = 1.0 / frameRate;
-    pthread_mutex_unlock(&param->lock);
+    memset(stats, 0, sizeof(GUIframeStats));
+    stats->frames = frame->frames;
+    stats->missed = frame->missed;
+    stats->rate = frame->rate;
+    if (frame->sampleCount == 0)
+        return;
+
+    float sorted[GUI_FRAME_SAMPLES];
+    memcpy(sorted, frame->samples, frame->sampleCount * sizeof(float));
+    qsort(sorted, frame->sampleCount, sizeof(float), guiFrameCompare);
+    stats->p50 = sorted[(frame->sampleCount - 1) / 2];
+    stats->p99 = sorted[(frame->sampleCount - 1) * 99 / 100];
 }
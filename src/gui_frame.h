@@ -1,8 +1,27 @@
 /**
- * \file guiframe.h
- * \brief 帧率控制
- * 
- * 通过定时发送信号量的方式控制帧率，同时会抛出空事件，调用者只需要等待事件即可，根据信号进行渲染
+ * \file gui_frame.h
+ * \brief 帧调度
+ *
+ * 在主线程中按截止时间等待事件, 不需要额外的线程:
+ * 没有需要重绘的内容时一直等待事件, 需要重绘时最多等到下一帧的截止时间.
+ * 动画或后台任务需要更多帧时用guiFrameRequest临时提高帧率.
+ * 记录每帧的耗时, 连续错过截止时间时自动降低帧率, 恢复后再提高, 请求的帧率也受此限制
+ *
+ * GUIFrame frame;
+ * guiFrameInit(&frame, 60, true);
+ * while (...)
+ * {
+ *     guiFrameWait(&frame, dirty, busy);
+ *     ...
+ *     if (guiFrameCheck(&frame, dirty))
+ *     {
+ *         guiFrameBegin(&frame);
+ *         ... // 渲染
+ *         guiFrameEnd(&frame);
+ *         glfwSwapBuffers(window);
+ *     }
+ * }
+ *
  * 只能在主线程中调用
  */
 #ifndef GUI_FRAME_H
@@ -10,41 +29,107 @@
 
 #include <stdio.h>
 
-#include <time.h>
+#include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
-#include <pthread.h>
-#include <semaphore.h>
 #include <GLFW/glfw3.h>
 
+#include "log.h"
 
+#define GUI_FRAME_SAMPLES 128 // 统计帧耗时的帧数
+#define GUI_FRAME_ADAPT 60    // 每隔多少帧调整一次帧率
+#define GUI_FRAME_RATE_MIN 10 // 自动降低帧率的下限
+
+/**
+ * \brief 帧耗时统计
+ */
 typedef struct
 {
-    sem_t semWait; // 时间信号量
-    sem_t semQuit; // 退出信号量
+    double p50;      // 帧耗时中位数(秒)
+    double p99;      // 帧耗时99分位(秒)
+    uint64_t frames; // 总帧数
+    uint64_t missed; // 错过截止时间的帧数
+    int rate;        // 当前帧率
+} GUIframeStats;
 
-    double frameRate; // 帧率时间, 1.0 / frameRate
+typedef struct
+{
+    int rate;            // 当前帧率, 自动调整
+    int rateMax;         // 设置的帧率, 没有请求时的上限
+    int rateLimit;       // 错过截止时间后降低的上限, 0表示没有限制
+    int requestRate;     // 请求的帧率
+    double requestUntil; // 请求的结束时间
+    bool vsync;          // 是否垂直同步
+    double deadline;     // 下一帧的截止时间
+    double begin;        // 当前帧的开始时间
 
-    pthread_mutex_t lock;  // 互斥锁，用于修改帧率
-    pthread_t guiFrameTID; // 线程ID
+    // 统计
+    float samples[GUI_FRAME_SAMPLES]; // 最近的帧耗时(秒), 环形缓冲区
+    int sampleCount;                  // 已记录的帧数, 不超过GUI_FRAME_SAMPLES
+    uint64_t frames;                  // 总帧数
+    uint64_t missed;                  // 错过截止时间的帧数
+    int adaptFrames;                  // 本次调整周期的帧数
+    int adaptMissed;                  // 本次调整周期错过截止时间的帧数
 } GUIFrame;
 
-// 获取信号量
-#define guiFrameGetSemWait(param) &((param)->semWait)
+/**
+ * \brief 初始化帧调度, 需要当前线程有OpenGL上下文
+ * \param frame 帧调度
+ * \param frameRate 帧率
+ * \param vsync 是否垂直同步
+ */
+void guiFrameInit(GUIFrame *frame, int frameRate, bool vsync);
+
+/**
+ * \brief 设置帧率, 同时作为自动调整的上限
+ * \param frame 帧调度
+ * \param frameRate 帧率
+ */
+void guiFrameSet(GUIFrame *frame, int frameRate);
+
+/**
+ * \brief 请求在一段时间内提高帧率, 多个请求取最高的帧率和最晚的结束时间
+ * \param frame 帧调度
+ * \param frameRate 请求的帧率, 不高于设置的帧率时没有作用
+ * \param until 结束时间(glfwGetTime)
+ * \note 错过截止时间降低的帧率同样限制请求的帧率
+ */
+void guiFrameRequest(GUIFrame *frame, int frameRate, double until);
+
+/**
+ * \brief 等待事件
+ * \param frame 帧调度
+ * \param dirty 是否有需要重绘的内容, 为真时最多等到下一帧的截止时间
+ * \param busy 是否有未处理完的后台任务, 为真时不等待
+ */
+void guiFrameWait(GUIFrame *frame, bool dirty, bool busy);
 
-// 检查是否需要渲染
-#define guiFrameCheck(param) (0 == sem_trywait(&((param)->semWait)))
+/**
+ * \brief 检查是否需要渲染
+ * \param frame 帧调度
+ * \param dirty 是否有需要重绘的内容
+ * \return 有需要重绘的内容并且到达截止时间
+ */
+bool guiFrameCheck(GUIFrame *frame, bool dirty);
 
-// 帧率控制
-GUIFrame *guiFrameCreate(int frameRate);
+/**
+ * \brief 开始一帧
+ * \param frame 帧调度
+ */
+void guiFrameBegin(GUIFrame *frame);
 
-// 销毁帧率控制
-void guiFrameDestroy(GUIFrame *param);
+/**
+ * \brief 结束一帧, 在交换缓冲区之前调用(垂直同步等待的时间不计入帧耗时)
+ * \param frame 帧调度
+ */
+void guiFrameEnd(GUIFrame *frame);
 
-// // 获取等待信号量
-// sem_t *guiFrameGetSemWait(GUIFrame *param);
+/**
+ * \brief 获取帧耗时统计
+ * \param frame 帧调度
+ * \param stats 统计
+ */
+void guiFrameGetStats(const GUIFrame *frame, GUIframeStats *stats);
 
-// 设置帧率
-void guiFrameSet(GUIFrame *param, int frameRate);
 #endif // GUI_FRAME_H
@@ -0,0 +1,118 @@
+#include "gui_hittest.h"
+#include "gui_widget.h"
+
+/**
+ * \brief 坐标对应的网格序号, 超出范围时取边缘的网格
+ */
+static int guiHitClamp(double v, int n)
+{
+    int i = (int)(v / GUI_HIT_CELL);
+    if (v < 0 || i < 0)
+        return 0;
+    return i < n ? i : n - 1;
+}
+
+/**
+ * \brief 矩形覆盖的网格范围
+ */
+static void guiHitRange(const GUIhitGrid *grid, const GUIrect *r, int *c0, int *r0, int *c1, int *r1)
+{
+    *c0 = guiHitClamp(r->x, grid->cols);
+    *r0 = guiHitClamp(r->y, grid->rows);
+    *c1 = guiHitClamp(r->x + r->w, grid->cols);
+    *r1 = guiHitClamp(r->y + r->h, grid->rows);
+}
+
+void guiHitInit(GUIhitGrid *grid, int width, int height)
+{
+    grid->cols = width > 0 ? (width + GUI_HIT_CELL - 1) / GUI_HIT_CELL : 1;
+    grid->rows = height > 0 ? (height + GUI_HIT_CELL - 1) / GUI_HIT_CELL : 1;
+    grid->cells = (GUIhitCell *)calloc(grid->cols * grid->rows, sizeof(GUIhitCell));
+    if (grid->cells == NULL)
+    {
+        ERROR("命中测试网格创建失败\n");
+        grid->cols = grid->rows = 0;
+    }
+}
+
+void guiHitQuit(GUIhitGrid *grid)
+{
+    for (int i = 0; i < grid->cols * grid->rows; i++)
+        free(grid->cells[i].items);
+    free(grid->cells);
+    memset(grid, 0, sizeof(GUIhitGrid));
+}
+
+void guiHitInsert(GUIhitGrid *grid, GUIwidget *widget)
+{
+    if (grid->cells == NULL || guiRectEmpty(&widget->rect))
+        return;
+
+    int c0, r0, c1, r1;
+    guiHitRange(grid, &widget->rect, &c0, &r0, &c1, &r1);
+    for (int r = r0; r <= r1; r++)
+    {
+        for (int c = c0; c <= c1; c++)
+        {
+            GUIhitCell *cell = &grid->cells[r * grid->cols + c];
+            if (cell->count == cell->cap)
+            {
+                int cap = cell->cap ? cell->cap * 2 : 4;
+                GUIwidget **items = (GUIwidget **)realloc(cell->items, cap * sizeof(GUIwidget *));
+                if (items == NULL)
+                {
+                    ERROR("命中测试网格扩容失败\n");
+                    continue;
+                }
+                cell->items = items;
+                cell->cap = cap;
+            }
+            cell->items[cell->count++] = widget;
+        }
+    }
+}
+
+void guiHitRemove(GUIhitGrid *grid, GUIwidget *widget)
+{
+    if (grid->cells == NULL || guiRectEmpty(&widget->rect))
+        return;
+
+    int c0, r0, c1, r1;
+    guiHitRange(grid, &widget->rect, &c0, &r0, &c1, &r1);
+    for (int r = r0; r <= r1; r++)
+    {
+        for (int c = c0; c <= c1; c++)
+        {
+            // 顺序不重要, 用最后一个填补
+            GUIhitCell *cell = &grid->cells[r * grid->cols + c];
+            for (int i = 0; i < cell->count; i++)
+            {
+                if (cell->items[i] == widget)
+                {
+                    cell->items[i] = cell->items[--cell->count];
+                    break;
+                }
+            }
+        }
+    }
+}
+
+int guiHitCount(const GUIhitGrid *grid, double x, double y)
+{
+    if (grid->cells == NULL)
+        return 0;
+    return grid->cells[guiHitClamp(y, grid->rows) * grid->cols + guiHitClamp(x, grid->cols)].count;
+}
+
+int guiHitQuery(const GUIhitGrid *grid, double x, double y, GUIwidget **out, int max)
+{
+    if (grid->cells == NULL)
+        return 0;
+
+    const GUIhitCell *cell = &grid->cells[guiHitClamp(y, grid->rows) * grid->cols + guiHitClamp(x, grid->cols)];
+    int count = 0;
+    for (int i = 0; i < cell->count && count < max; i++)
+        if (guiRectContains(&cell->items[i]->rect, x, y))
+            out[count++] = cell->items[i];
+    return count;
+}
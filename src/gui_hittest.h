@@ -0,0 +1,130 @@
+/**
+ * \file gui_hittest.h
+ * \brief GUI 指针事件的命中测试, 均匀网格空间索引
+ *
+ * 设置了命中区域的控件按区域登记到覆盖的网格中, 指针事件只需要检查光标所在网格中的控件;
+ * 没有命中区域的控件(如拖动整个窗口)仍然接收所有指针事件
+ */
+#ifndef GUI_HITTEST_H
+#define GUI_HITTEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GUI_HIT_CELL 64 // 网格大小(像素)
+
+typedef struct _GUIwidget GUIwidget;
+
+/**
+ * \brief 矩形(窗口坐标, 与光标坐标相同, 原点在左上角)
+ */
+typedef struct
+{
+    double x; // 左
+    double y; // 上
+    double w; // 宽
+    double h; // 高
+} GUIrect;
+
+/**
+ * \brief 矩形是否为空, 空的命中区域表示接收所有指针事件
+ */
+static inline bool guiRectEmpty(const GUIrect *r)
+{
+    return r->w <= 0 || r->h <= 0;
+}
+
+/**
+ * \brief 点是否在矩形内
+ */
+static inline bool guiRectContains(const GUIrect *r, double x, double y)
+{
+    return x >= r->x && y >= r->y && x < r->x + r->w && y < r->y + r->h;
+}
+
+/**
+ * \brief 包含两个矩形的最小矩形, 空矩形不参与合并
+ */
+static inline GUIrect guiRectUnion(const GUIrect *a, const GUIrect *b)
+{
+    if (guiRectEmpty(a))
+        return *b;
+    if (guiRectEmpty(b))
+        return *a;
+
+    double x0 = a->x < b->x ? a->x : b->x;
+    double y0 = a->y < b->y ? a->y : b->y;
+    double x1 = a->x + a->w > b->x + b->w ? a->x + a->w : b->x + b->w;
+    double y1 = a->y + a->h > b->y + b->h ? a->y + a->h : b->y + b->h;
+    return (GUIrect){x0, y0, x1 - x0, y1 - y0};
+}
+
+/**
+ * \brief 网格
+ */
+typedef struct
+{
+    GUIwidget **items; // 与网格相交的控件
+    int count;         // 控件数量
+    int cap;           // 容量
+} GUIhitCell;
+
+/**
+ * \brief 均匀网格
+ */
+typedef struct
+{
+    GUIhitCell *cells; // 网格, 按行排列
+    int cols;          // 列数
+    int rows;          // 行数
+} GUIhitGrid;
+
+/**
+ * \brief 初始化网格, 窗口之外的区域归入边缘的网格
+ * \param grid 网格
+ * \param width 窗口宽度
+ * \param height 窗口高度
+ */
+void guiHitInit(GUIhitGrid *grid, int width, int height);
+
+/**
+ * \brief 释放网格
+ * \param grid 网格
+ */
+void guiHitQuit(GUIhitGrid *grid);
+
+/**
+ * \brief 按控件的命中区域登记到网格
+ * \param grid 网格
+ * \param widget 控件
+ */
+void guiHitInsert(GUIhitGrid *grid, GUIwidget *widget);
+
+/**
+ * \brief 从网格中移除控件, 命中区域必须与登记时相同
+ * \param grid 网格
+ * \param widget 控件
+ */
+void guiHitRemove(GUIhitGrid *grid, GUIwidget *widget);
+
+/**
+ * \brief 该点所在网格中登记的控件数量, 是guiHitQuery返回数量的上限
+ * \param grid 网格
+ * \param x 光标X坐标
+ * \param y 光标Y坐标
+ * \return 控件数量
+ */
+int guiHitCount(const GUIhitGrid *grid, double x, double y);
+
+/**
+ * \brief 查找命中区域包含该点的控件
+ * \param grid 网格
+ * \param x 光标X坐标
+ * \param y 光标Y坐标
+ * \param out 控件
+ * \param max 最多返回的数量
+ * \return 控件数量
+ */
+int guiHitQuery(const GUIhitGrid *grid, double x, double y, GUIwidget **out, int max);
+
+#endif // GUI_HITTEST_H
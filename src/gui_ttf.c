@@ -1,22 +1,143 @@
 #include "gui_ttf.h"
+#include "trace.h"
 
 #define GUI_TTF_FONT_R 3                         // 文字预留空间
 #define GUI_TTF_FONT_INIT 0x20                   // 初始化文字数量
 #define GUI_TTF_FONT_ADD (GUI_TTF_FONT_INIT * 2) // 每次添加文字数量
+#define GUI_TTF_ATLAS_SIZE 512                   // 图集每页的最小边长
+#define GUI_TTF_ATLAS_MAX 4096                   // 图集每页的最大边长
+#define GUI_TTF_ATLAS_PAD 1                      // 位图之间的间隔, 避免线性过滤时采样到相邻文字
+
+/**
+ * \brief 添加一页图集, 内容清零(间隔需要为0)
+ */
+static bool guiFontAtlasAddPage(GUIfont *font)
+{
+    unsigned char *zero = (unsigned char *)calloc((size_t)font->pageSize * font->pageSize, 1);
+    GLuint *pages = (GLuint *)realloc(font->pages, sizeof(GLuint) * (font->pageCount + 1));
+    if (zero == NULL || pages == NULL)
+    {
+        ERROR("字体图集创建失败\n");
+        free(zero);
+        if (pages)
+            font->pages = pages;
+        return false;
+    }
+    font->pages = pages;
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // 不需要多级纹理
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, font->pageSize, font->pageSize, 0, GL_RED, GL_UNSIGNED_BYTE, zero);
+    free(zero);
+
+    font->pages[font->pageCount++] = texture;
+    font->shelfX = GUI_TTF_ATLAS_PAD;
+    font->shelfY = GUI_TTF_ATLAS_PAD;
+    font->shelfH = 0;
+    return true;
+}
+
+/**
+ * \brief 在图集中分配位图的位置, 当前行放不下时换行, 当前页放不下时添加新页
+ * \param font 字号
+ * \param w 位图宽度
+ * \param h 位图高度
+ * \param x 位图在页中的X坐标
+ * \param y 位图在页中的Y坐标
+ * \return 所在页的纹理, 0表示失败
+ */
+static GLuint guiFontAtlasAlloc(GUIfont *font, int w, int h, int *x, int *y)
+{
+    if (w + GUI_TTF_ATLAS_PAD * 2 > font->pageSize || h + GUI_TTF_ATLAS_PAD * 2 > font->pageSize)
+    {
+        ERROR("文字位图(%dx%d)超过图集大小\n", w, h);
+        return 0;
+    }
+
+    // 换行
+    if (font->pageCount > 0 && font->shelfX + w + GUI_TTF_ATLAS_PAD > font->pageSize)
+    {
+        font->shelfX = GUI_TTF_ATLAS_PAD;
+        font->shelfY += font->shelfH + GUI_TTF_ATLAS_PAD;
+        font->shelfH = 0;
+    }
+
+    // 换页
+    if (font->pageCount == 0 || font->shelfY + h + GUI_TTF_ATLAS_PAD > font->pageSize)
+        if (guiFontAtlasAddPage(font) == false)
+            return 0;
+
+    *x = font->shelfX;
+    *y = font->shelfY;
+    font->shelfX += w + GUI_TTF_ATLAS_PAD;
+    if (h > font->shelfH)
+        font->shelfH = h;
+    return font->pages[font->pageCount - 1];
+}
+
+/**
+ * \brief 在共享VBO中分配4个顶点, 容量不足时扩展(VAO不变)
+ * \return 第一个顶点, -1表示失败
+ */
+static GLint guiFontVertexAlloc(GUIfont *font)
+{
+    // 第一次使用时创建
+    if (font->VAO == 0)
+    {
+        glGenVertexArrays(1, &font->VAO);
+        glGenBuffers(1, &font->VBO);
+        font->vertexMax = GUI_TTF_FONT_INIT * 4;
+        glBindBuffer(GL_ARRAY_BUFFER, font->VBO);
+        glBufferData(GL_ARRAY_BUFFER, font->vertexMax * 4 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+        glBindVertexArray(font->VAO);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+    }
+
+    // 扩展: 复制到新的VBO, 重新设置VAO的顶点属性
+    if (font->vertexCount + 4 > font->vertexMax)
+    {
+        GLuint VBO;
+        int vertexMax = font->vertexMax * 2;
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        glBufferData(GL_COPY_WRITE_BUFFER, vertexMax * 4 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, font->VBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, font->vertexCount * 4 * sizeof(float));
+        glDeleteBuffers(1, &font->VBO);
+        font->VBO = VBO;
+        font->vertexMax = vertexMax;
+
+        glBindVertexArray(font->VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, font->VBO);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
+        glBindVertexArray(0);
+    }
+
+    GLint first = font->vertexCount;
+    font->vertexCount += 4;
+    return first;
+}
 
 GUIchar *guiCharCreate(GUIttf *ttf, GUIfont *font, wchar_t text)
 {
     if (!font && !ttf)
         return NULL;
 
-    /* 添加文字 */
-    GUIchar *ttfChar;
-    font->textList[font->textCount] = text;
-    ttfChar = &font->textRend[font->textCount++];
-    font->textList[font->textCount] = L'\0';
+    TRACE_ZONE("guiCharCreate");
 
-    /* 检查文本列表是否已满 */
-    if (font->textCount >= font->textMax - GUI_TTF_FONT_R)
+    /* 检查文本列表是否已满, 需要在取得文字地址之前扩展 */
+    if (font->textCount + 1 >= font->textMax - GUI_TTF_FONT_R)
     {
         // 扩展列表
         font->textMax += GUI_TTF_FONT_ADD;
@@ -28,6 +149,12 @@ GUIchar *guiCharCreate(GUIttf *ttf, GUIfont *font, wchar_t text)
         memset(&font->textRend[font->textCount], 0, sizeof(GUIchar) * (font->textMax - font->textCount));
     }
 
+    /* 添加文字 */
+    GUIchar *ttfChar;
+    font->textList[font->textCount] = text;
+    ttfChar = &font->textRend[font->textCount++];
+    font->textList[font->textCount] = L'\0';
+
     /* 设置文字信息 */
     ttfChar->text = text;
     ttfChar->ascent = font->ascent;
@@ -39,37 +166,39 @@ GUIchar *guiCharCreate(GUIttf *ttf, GUIfont *font, wchar_t text)
     ttfChar->advance *= font->scale;
     ttfChar->x *= font->scale;
 
-    /* 创建纹理 */
+    /* 位图写入图集 */
     unsigned char *data = stbtt_GetCodepointBitmap(&ttf->fontInfo, font->scale, font->scale, text, &ttfChar->w, &ttfChar->h, &ttfChar->x, &ttfChar->y);
     ttfChar->y = -ttfChar->y;
-    ttfChar->texture = guiTextureCreate(data, ttfChar->w, ttfChar->h, 1, GL_RED);
+    if (data && ttfChar->w > 0 && ttfChar->h > 0)
+    {
+        int x, y;
+        ttfChar->texture = guiFontAtlasAlloc(font, ttfChar->w, ttfChar->h, &x, &y);
+        if (ttfChar->texture)
+        {
+            glBindTexture(GL_TEXTURE_2D, ttfChar->texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, ttfChar->w, ttfChar->h, GL_RED, GL_UNSIGNED_BYTE, data);
+
+            ttfChar->uv[0] = (float)x / font->pageSize;
+            ttfChar->uv[1] = (float)y / font->pageSize;
+            ttfChar->uv[2] = (float)(x + ttfChar->w) / font->pageSize;
+            ttfChar->uv[3] = (float)(y + ttfChar->h) / font->pageSize;
+        }
+    }
     stbtt_FreeBitmap(data, 0);
 
-    /* 设置VAO, VBO, EBO */
+    /* 顶点写入共享的VBO */
+    const float *uv = ttfChar->uv;
     float vertices[] = {
         // 位置             // 纹理坐标
-        (float)(ttfChar->x), (float)(ttfChar->y), 0.0f, 0.0f,
-        (float)(ttfChar->x + ttfChar->w), (float)(ttfChar->y), 1.0f, 0.0f,
-        (float)(ttfChar->x + ttfChar->w), (float)(ttfChar->y - ttfChar->h), 1.0f, 1.0f,
-        (float)(ttfChar->x), (float)(ttfChar->y - ttfChar->h), 0.0f, 1.0f};
-    const GLuint index[] = {
-        0, 1, 2,
-        0, 2, 3};
-    glGenVertexArrays(1, &ttfChar->VAO);
-    glGenBuffers(1, &ttfChar->VBO);
-    glGenBuffers(1, &ttfChar->EBO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, ttfChar->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ttfChar->EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(index), index, GL_STATIC_DRAW);
-
-    glBindVertexArray(ttfChar->VAO);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+        (float)(ttfChar->x), (float)(ttfChar->y), uv[0], uv[1],
+        (float)(ttfChar->x + ttfChar->w), (float)(ttfChar->y), uv[2], uv[1],
+        (float)(ttfChar->x + ttfChar->w), (float)(ttfChar->y - ttfChar->h), uv[2], uv[3],
+        (float)(ttfChar->x), (float)(ttfChar->y - ttfChar->h), uv[0], uv[3]};
+    ttfChar->first = guiFontVertexAlloc(font);
+    ttfChar->VAO = font->VAO;
+    glBindBuffer(GL_ARRAY_BUFFER, font->VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, ttfChar->first * 4 * sizeof(float), sizeof(vertices), vertices);
 
     return ttfChar;
 }
@@ -110,11 +239,12 @@ GUIchar *guiCharGetFromTTF(GUIttf *ttf, wchar_t text, int pixels)
 
 void guiCharRender(GUIchar *c)
 {
-    glBindTexture(GL_TEXTURE_2D, c->texture);            // 绑定纹理
-    glBindVertexArray(c->VAO);                           // 绑定VAO
-    glBindBuffer(GL_ARRAY_BUFFER, c->VBO);               // 绑定VBO
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c->EBO);       // 绑定EBO
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0); // 绘制
+    if (c->texture == 0) // 空白文字
+        return;
+
+    glBindTexture(GL_TEXTURE_2D, c->texture);   // 绑定图集纹理
+    glBindVertexArray(c->VAO);                  // 绑定字号共享的VAO
+    glDrawArrays(GL_TRIANGLE_FAN, c->first, 4); // 绘制
 }
 
 void guiFontInit(GUIttf *ttf, GUIfont *font, int pixels)
@@ -127,6 +257,16 @@ void guiFontInit(GUIttf *ttf, GUIfont *font, int pixels)
     font->descent *= font->scale;
     font->lineGap *= font->scale;
 
+    // 图集每页至少能放下8x8个文字, 在第一次创建文字时创建
+    font->pages = NULL;
+    font->pageCount = 0;
+    font->pageSize = GUI_TTF_ATLAS_SIZE;
+    while (font->pageSize < pixels * 8 && font->pageSize < GUI_TTF_ATLAS_MAX)
+        font->pageSize *= 2;
+    font->shelfX = font->shelfY = font->shelfH = 0;
+    font->VAO = font->VBO = 0;
+    font->vertexCount = font->vertexMax = 0;
+
     // 初始化文本列表
     font->textMax = GUI_TTF_FONT_INIT;
     font->textCount = 0;
@@ -195,14 +335,10 @@ void guiTTFDelete(GUIttf *ttf)
     for (int i = 0; i < ttf->fontCount; i++)
     {
         GUIfont *font = &ttf->fontList[i];
-        for (int j = 0; j < font->textCount; j++)
-        {
-            GUIchar *c = &font->textRend[j];
-            glDeleteTextures(1, &c->texture);
-            glDeleteVertexArrays(1, &c->VAO);
-            glDeleteBuffers(1, &c->VBO);
-            glDeleteBuffers(1, &c->EBO);
-        }
+        glDeleteTextures(font->pageCount, font->pages);
+        glDeleteVertexArrays(1, &font->VAO);
+        glDeleteBuffers(1, &font->VBO);
+        free(font->pages);
         free(font->textList);
         free(font->textRend);
     }
@@ -12,12 +12,15 @@
  * guiCharRender(c1);
  * guiCharRender(c2);
  *
+ * 每个字号的文字位图按行(shelf)打包到图集纹理中, 图集满时添加新的一页;
+ * 所有文字的顶点放在字号共享的VBO中, 不再为每个文字创建纹理和顶点对象
  */
 #ifndef GUI_TTF_H
 #define GUI_TTF_H
 
 #include <stdio.h>
 #include <wchar.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -48,8 +51,10 @@ typedef struct
     int w; // 位图宽度
     int h; // 位图高度
 
-    GLuint VAO, VBO, EBO; // 渲染
-    GLuint texture;       // 纹理
+    float uv[4];    // 在图集中的纹理坐标(左, 上, 右, 下)
+    GLuint texture; // 所在图集页的纹理, 属于字号
+    GLuint VAO;     // 字号共享的VAO
+    GLint first;    // 在共享VBO中的第一个顶点
 } GUIchar;
 
 /**
@@ -68,6 +73,19 @@ typedef struct
     GUIchar *textRend; // 文本渲染列表
     int textCount;     // 文字数量
     int textMax;       // 最大文字数量
+
+    // 图集, 在创建第一个文字时创建
+    GLuint *pages; // 图集各页的纹理
+    int pageCount; // 页数
+    int pageSize;  // 每页的边长
+    int shelfX;    // 当前行下一个位图的X坐标
+    int shelfY;    // 当前行的Y坐标
+    int shelfH;    // 当前行的高度
+
+    // 共享的顶点, 每个文字4个顶点
+    GLuint VAO, VBO; // 渲染
+    int vertexCount; // 顶点数量
+    int vertexMax;   // VBO容量(顶点)
 } GUIfont;
 
 /**
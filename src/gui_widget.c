@@ -43,19 +43,64 @@ void guiWidgetInit(GUIwidget *widget,
     widget->data2 = data2;
 
     widget->win = NULL;
+    widget->nodeWidget = NULL;
+
+    ilistInit(&widget->linkDraw);
+    ilistInit(&widget->linkEventMouseButton);
+    ilistInit(&widget->linkEventCursorPos);
+    ilistInit(&widget->linkEventCharMods);
+    ilistInit(&widget->linkEventScroll);
 
     widget->StartCall = StartCall;
     widget->DestroyCall = DestroyCall;
 
-    // 注册控件
-    guiIDRegister(widget->id, widget);
+    // 注册控件, GUI_WIDGET_ID_NEW时由注册表分配ID
+    if (id == GUI_WIDGET_ID_NEW)
+        widget->id = guiIDCreate(widget);
+    else
+        guiIDRegister(widget->id, widget);
 
     // 调用初始化函数
     CALL(widget->StartCall, widget);
 }
 
+void guiWidgetSetRect(GUIwidget *widget, double x, double y, double w, double h)
+{
+    // 已经添加到窗口时, 需要更新窗口的命中测试网格
+    GUIwin *win = widget->win;
+    if (win)
+    {
+        guiWindowDetachPointer(win, widget);
+        if (widget->priorityDraw >= 0)
+            guiWidgetMarkDirty(widget, NULL); // 原来的区域
+    }
+
+    widget->rect = (GUIrect){x, y, w, h};
+
+    if (win)
+    {
+        guiWindowAttachPointer(win, widget);
+        if (widget->priorityDraw >= 0)
+            guiWidgetMarkDirty(widget, NULL); // 新的区域
+    }
+}
+
+void guiWidgetMarkDirty(GUIwidget *widget, const GUIrect *rect)
+{
+    // 没有添加到窗口时不需要重绘
+    if (widget->win == NULL)
+        return;
+
+    if (rect == NULL && guiRectEmpty(&widget->rect) == false)
+        rect = &widget->rect;
+    guiWindowDamage(widget->win, rect);
+}
+
 void guiWidgetDestroy(GUIwidget *widget)
 {
     // 调用初始化函数
     CALL(widget->DestroyCall, widget);
+
+    // 注销控件
+    guiIDUnregister(widget->id);
 }
\ No newline at end of file
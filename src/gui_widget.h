@@ -16,6 +16,8 @@
 
 #include "gui_window.h"
 #include "list.h"
+#include "ilist.h"
+#include "gui_hittest.h"
 
 #define GUI_WIDGET_FLAG_VISIBLE 0x00000001
 #define GUI_WIDGET_FLAG_ENABLE 0x00000002
@@ -50,6 +52,20 @@ typedef struct _GUIwidget
     // 窗口指针
     GUIwin *win; // 绑定的窗口
 
+    // 在窗口控件列表中的节点, 由窗口维护, 移除时不需要查找
+    list *nodeWidget;
+    uint64_t seq; // 添加到窗口的顺序, 相同优先级的控件按此顺序调用
+
+    // 指针事件(鼠标, 光标, 滚轮)的命中区域, 为空时接收所有指针事件
+    GUIrect rect;
+
+    // 窗口中各个优先级列表的链接, 由窗口维护
+    ilist linkDraw;             // 渲染列表
+    ilist linkEventMouseButton; // 鼠标事件列表
+    ilist linkEventCursorPos;   // 光标事件列表
+    ilist linkEventCharMods;    // 字符事件列表
+    ilist linkEventScroll;      // 滚轮事件列表
+
     // 创建和销毁调用函数
     void (*StartCall)(GUIwidget *widget);   // 注册控件时的函数
     void (*DestroyCall)(GUIwidget *widget); // 销毁控件时的函数
@@ -58,6 +74,7 @@ typedef struct _GUIwidget
 
 /**
  * \brief 初始化并注册控件
+ * \note id为GUI_WIDGET_ID_NEW时由注册表分配, 分配的ID保存在widget->id
  */
 void guiWidgetInit(GUIwidget *widget,
                    uint64_t flag,
@@ -78,7 +95,24 @@ void guiWidgetInit(GUIwidget *widget,
                    void (*DestroyCall)(GUIwidget *widget));
 
 /**
- * \brief 销毁控件
+ * \brief 设置控件的命中区域, 之后只有光标在区域内时才接收指针事件
+ * \param widget 控件
+ * \param x 左(窗口坐标)
+ * \param y 上(窗口坐标)
+ * \param w 宽, 为0时清除命中区域
+ * \param h 高, 为0时清除命中区域
+ */
+void guiWidgetSetRect(GUIwidget *widget, double x, double y, double w, double h);
+
+/**
+ * \brief 标记控件需要重绘
+ * \param widget 控件
+ * \param rect 需要重绘的区域(窗口坐标), NULL表示整个命中区域, 没有命中区域时为整个窗口
+ */
+void guiWidgetMarkDirty(GUIwidget *widget, const GUIrect *rect);
+
+/**
+ * \brief 销毁控件并注销ID
  */
 void guiWidgetDestroy(GUIwidget *widget);
 
@@ -1,26 +1,126 @@
 #include "gui_widgetID.h"
 
-GUIwidget **IDlist = NULL;
-bool guiIDRegister(uint64_t id, GUIwidget *widget)
+#define GUI_ID_INDEX(id) ((uint32_t)(id))        // 槽位序号
+#define GUI_ID_GEN(id) ((uint32_t)((id) >> 32))  // 代数
+#define GUI_ID_MAKE(index, gen) (((uint64_t)(gen) << 32) | (uint32_t)(index))
+#define GUI_ID_SLOT_MIN 64                       // 初始槽位数量
+#define GUI_ID_FREE_END UINT32_MAX               // 空闲链表结尾
+
+/**
+ * \brief 注册表的槽位
+ */
+typedef struct
 {
-    if(IDlist == NULL)
+    GUIwidget *widget; // 控件, 空闲时为NULL
+    uint32_t gen;      // 代数, 动态ID注销后加一, 旧的ID因此失效
+    uint32_t nextFree; // 下一个空闲槽位
+} GUIidSlot;
+
+static GUIidSlot *IDlist = NULL;                  // 槽位, 前GUI_WIDGET_ID_MAX个固定给枚举ID使用
+static uint32_t IDcap = 0;                        // 槽位数量
+static uint32_t IDused = GUI_WIDGET_ID_MAX;       // 已经使用过的槽位数量
+static uint32_t IDfree = GUI_ID_FREE_END;         // 空闲槽位链表(只包含动态ID的槽位)
+
+/**
+ * \brief 保证槽位数量足够, 不足时翻倍
+ */
+static bool guiIDReserve(uint32_t count)
+{
+    if (count <= IDcap)
+        return true;
+
+    uint32_t cap = IDcap ? IDcap : GUI_ID_SLOT_MIN;
+    while (cap < count)
+        cap *= 2;
+
+    GUIidSlot *slots = (GUIidSlot *)realloc(IDlist, cap * sizeof(GUIidSlot));
+    if (slots == NULL)
     {
-        IDlist = (GUIwidget**)malloc(GUI_WIDGET_ID_MAX * sizeof(GUIwidget**));
-        memset(IDlist, 0, GUI_WIDGET_ID_MAX * sizeof(GUIwidget**));
+        ERROR("ID列表扩容失败\n");
+        return false;
     }
+    memset(slots + IDcap, 0, (cap - IDcap) * sizeof(GUIidSlot));
+    IDlist = slots;
+    IDcap = cap;
+    return true;
+}
+
+/**
+ * \brief 查找ID对应的槽位
+ * \return 槽位, ID无效或已经注销时返回NULL
+ */
+static GUIidSlot *guiIDSlot(uint64_t id)
+{
+    uint32_t index = GUI_ID_INDEX(id);
+    if (index >= IDused || index >= IDcap)
+        return NULL;
+
+    GUIidSlot *slot = &IDlist[index];
+    if (slot->widget == NULL || slot->gen != GUI_ID_GEN(id))
+        return NULL;
+    return slot;
+}
+
+bool guiIDRegister(uint64_t id, GUIwidget *widget)
+{
+    if (guiIDReserve(GUI_WIDGET_ID_MAX) == false)
+        return false;
     if(id >= GUI_WIDGET_ID_MAX)
     {
         // ID范围出错了
-        ERROR("ID范围出错了:ID = %lld\n", id);
+        ERROR("ID范围出错了:ID = %llu\n", (unsigned long long)id);
         return false;
     }
-    if(IDlist[id] != NULL)
+    if(IDlist[id].widget != NULL)
     {
         // 已经注册过了
-        ERROR("ID为:%lld的控件已经注册过了\n", id);
+        ERROR("ID为:%llu的控件已经注册过了\n", (unsigned long long)id);
         return false;
     }
-    IDlist[id] = widget;
+    IDlist[id].widget = widget;
+    return true;
+}
+
+uint64_t guiIDCreate(GUIwidget *widget)
+{
+    if (widget == NULL || guiIDReserve(GUI_WIDGET_ID_MAX) == false)
+        return GUI_WIDGET_ID_NEW;
+
+    // 优先复用注销的槽位
+    uint32_t index = IDfree;
+    if (index != GUI_ID_FREE_END)
+        IDfree = IDlist[index].nextFree;
+    else
+    {
+        if (IDused == GUI_ID_FREE_END || guiIDReserve(IDused + 1) == false)
+            return GUI_WIDGET_ID_NEW;
+        index = IDused++;
+        IDlist[index].gen = 1; // 动态ID的代数从1开始, 不会与枚举ID相同
+    }
+
+    IDlist[index].widget = widget;
+    return GUI_ID_MAKE(index, IDlist[index].gen);
+}
+
+bool guiIDUnregister(uint64_t id)
+{
+    GUIidSlot *slot = guiIDSlot(id);
+    if (slot == NULL)
+    {
+        ERROR("ID为:%llu的控件没有注册过\n", (unsigned long long)id);
+        return false;
+    }
+    slot->widget = NULL;
+
+    // 动态ID的槽位增加代数后放回空闲链表
+    uint32_t index = GUI_ID_INDEX(id);
+    if (index >= GUI_WIDGET_ID_MAX)
+    {
+        if (++slot->gen == 0)
+            slot->gen = 1;
+        slot->nextFree = IDfree;
+        IDfree = index;
+    }
     return true;
 }
 
@@ -35,19 +135,14 @@ GUIwidget *guiIDGetFromID(uint64_t id)
         ERROR("ID列表为空\n");
         return NULL;
     }
-    if(id >= GUI_WIDGET_ID_MAX)
+    GUIwidget *widget = guiIDSlot(id) ? IDlist[GUI_ID_INDEX(id)].widget : NULL;
+    if(widget == NULL)
     {
-        // ID范围出错了
-        ERROR("ID范围出错了:ID = %lld\n", id);
+        // 没有注册过或已经注销
+        ERROR("ID为:%llu的控件没有注册过\n", (unsigned long long)id);
         return NULL;
     }
-    if(IDlist[id] == NULL)
-    {
-        // 没有注册过
-        ERROR("ID为:%lld的控件没有注册过\n", id);
-        return NULL;
-    }
-    return IDlist[id];
+    return widget;
 }
 
 /**
@@ -62,14 +157,13 @@ uint64_t guiIDGetFromWidget(GUIwidget *widget)
         ERROR("ID列表为空\n");
         return 0;
     }
-    for(int i = 0; i < GUI_WIDGET_ID_MAX; i++)
-    {
-        if(IDlist[i] == widget)
-        {
-            return (uint64_t)i;
-        }
-    }
+
+    // 控件中保存了自己的ID, 只需要确认注册表中对应的是该控件
+    GUIidSlot *slot = widget ? guiIDSlot(widget->id) : NULL;
+    if(slot != NULL && slot->widget == widget)
+        return widget->id;
+
     // 没有注册过
-    ERROR("控件地址为:%p的控件没有注册过\n", widget);
+    ERROR("控件地址为:%p的控件没有注册过\n", (void *)widget);
     return 0;
-}
\ No newline at end of file
+}
@@ -1,6 +1,9 @@
 /**
  * \file gui_widgetID.h
  * \brief GUI 控件ID
+ *
+ * 固定的控件使用下面的枚举ID; 运行时创建的控件(如每张图像的面板)使用GUI_WIDGET_ID_NEW,
+ * 由注册表分配ID. 动态ID的高32位为代数, 控件注销后旧的ID失效, 槽位可以复用
  */
 
 #ifndef GUI_WIDGETID_H
@@ -14,9 +17,12 @@ enum
 {
     GUI_WIDGET_ID_START,
     GUI_WIDGET_ID_MOUSEMOVE, // 鼠标移动窗口控件
+    GUI_WIDGET_ID_HUD,       // 性能统计控件
     GUI_WIDGET_ID_MAX
 };
 
+#define GUI_WIDGET_ID_NEW UINT64_MAX // 由注册表分配ID
+
 typedef struct _GUIwidget GUIwidget;
 
 /**
@@ -24,6 +30,20 @@ typedef struct _GUIwidget GUIwidget;
  */
 bool guiIDRegister(uint64_t id, GUIwidget *widget);
 
+/**
+ * \brief 为控件分配一个动态ID并注册
+ * \param widget 控件
+ * \return ID, 失败返回GUI_WIDGET_ID_NEW
+ */
+uint64_t guiIDCreate(GUIwidget *widget);
+
+/**
+ * \brief 注销控件ID, 动态ID注销后失效
+ * \param id 控件ID
+ * \return 是否成功
+ */
+bool guiIDUnregister(uint64_t id);
+
 /**
  * \brief 根据控件ID获取控件
  */
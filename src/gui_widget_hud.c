@@ -0,0 +1,310 @@
+#include "gui_widget_hud.h"
+#include "gui.h"
+#include "resource.h"
+
+#define HUD_X 8       // 左上角X坐标
+#define HUD_Y 8       // 左上角Y坐标
+#define HUD_PAD 4     // 边距
+#define HUD_COLUMN 2  // 每帧的宽度
+#define HUD_GRAPH 100 // 图表高度
+#define HUD_ROW 8     // 每个控件的行高
+#define HUD_W (HUD_PAD * 2 + GUI_HUD_HISTORY * HUD_COLUMN)          // 宽度
+#define HUD_H (HUD_PAD * 3 + HUD_GRAPH + GUI_HUD_WIDGETS * HUD_ROW) // 高度
+
+// 各部分的颜色
+static const float guiHudColor[GUI_HUD_NUM][4] = {
+    {0.3f, 0.6f, 1.0f, 1.0f}, // 事件分发
+    {0.3f, 0.9f, 0.3f, 1.0f}, // 绘制回调
+    {0.6f, 0.6f, 0.6f, 1.0f}, // 交换缓冲区
+    {1.0f, 0.3f, 0.3f, 1.0f}, // GPU
+};
+
+void guiHudWidgetTime(GUIhud *hud, GUIwidget *widget, double time)
+{
+    GUIhudWidget *slot = NULL;
+    for (int i = 0; i < hud->widgetCount && slot == NULL; i++)
+        if (hud->widgets[i].widget == widget)
+            slot = &hud->widgets[i];
+
+    // 新的控件, 已满时替换耗时最少的
+    if (slot == NULL)
+    {
+        if (hud->widgetCount < GUI_HUD_WIDGETS)
+        {
+            slot = &hud->widgets[hud->widgetCount++];
+        }
+        else
+        {
+            slot = &hud->widgets[0];
+            for (int i = 1; i < hud->widgetCount; i++)
+                if (hud->widgets[i].avg < slot->avg)
+                    slot = &hud->widgets[i];
+        }
+        *slot = (GUIhudWidget){widget, widget->id, 0, 0};
+    }
+
+    slot->frame += time;
+    hud->frame[GUI_HUD_DRAW] += time;
+}
+
+void guiHudGpuBegin(GUIhud *hud)
+{
+    // 查询结果还没有读取时跳过这一帧
+    hud->queryActive = hud->queryPending[hud->queryIndex] == false;
+    if (hud->queryActive)
+        glBeginQuery(GL_TIME_ELAPSED, hud->queries[hud->queryIndex]);
+}
+
+void guiHudGpuEnd(GUIhud *hud)
+{
+    if (hud->queryActive == false)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    hud->queryPending[hud->queryIndex] = true;
+    hud->queryIndex = (hud->queryIndex + 1) % GUI_HUD_QUERIES;
+    hud->queryActive = false;
+}
+
+void guiHudFrameEnd(GUIhud *hud)
+{
+    // 读取已经完成的GPU查询, 不等待
+    for (int i = 0; i < GUI_HUD_QUERIES; i++)
+    {
+        int index = (hud->queryIndex + i) % GUI_HUD_QUERIES; // 从最早的开始
+        if (hud->queryPending[index] == false)
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(hud->queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0)
+            break;
+
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(hud->queries[index], GL_QUERY_RESULT, &ns);
+        hud->gpu = ns * 1e-9;
+        hud->queryPending[index] = false;
+    }
+    hud->frame[GUI_HUD_GPU] = hud->gpu;
+
+    // 写入图表
+    for (int i = 0; i < GUI_HUD_NUM; i++)
+        hud->history[hud->historyIndex][i] = (float)hud->frame[i];
+    hud->historyIndex = (hud->historyIndex + 1) % GUI_HUD_HISTORY;
+
+    // 平滑控件耗时
+    for (int i = 0; i < hud->widgetCount; i++)
+    {
+        hud->widgets[i].avg = hud->widgets[i].avg * 0.9 + hud->widgets[i].frame * 0.1;
+        hud->widgets[i].frame = 0;
+    }
+
+    // 每秒输出一行汇总, 控件的绘制耗时只在图表中显示
+    double now = glfwGetTime();
+    if (now - hud->logTime >= 1.0)
+    {
+        hud->logTime = now;
+        DEBUG("HUD: 事件 %.2fms, 绘制 %.2fms, 交换 %.2fms, GPU %.2fms\n", hud->frame[GUI_HUD_DISPATCH] * 1000,
+              hud->frame[GUI_HUD_DRAW] * 1000, hud->frame[GUI_HUD_SWAP] * 1000, hud->frame[GUI_HUD_GPU] * 1000);
+    }
+
+    memset(hud->frame, 0, sizeof(hud->frame));
+}
+
+/**
+ * \brief 添加一个矩形(窗口坐标)到当前颜色的顶点
+ */
+static void guiHudQuad(GUIhud *hud, GUIwin *win, float x, float y, float w, float h)
+{
+    if (hud->vertexCount + 6 > hud->vertexMax || w <= 0 || h <= 0)
+        return;
+
+    // 窗口坐标(原点在左上角)转换为PV的坐标(原点在中心, Y轴向上, 单位为像素)
+    int width, height;
+    glfwGetWindowSize(win->window, &width, &height);
+    float x0 = x - width / 2.0f, x1 = x0 + w;
+    float y0 = height / 2.0f - y, y1 = y0 - h;
+
+    const float quad[6][2] = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y0}, {x1, y1}, {x0, y1}};
+    float *v = hud->vertices + hud->vertexCount * 3;
+    for (int i = 0; i < 6; i++)
+    {
+        v[i * 3 + 0] = quad[i][0];
+        v[i * 3 + 1] = quad[i][1];
+        v[i * 3 + 2] = 0.0f;
+    }
+    hud->vertexCount += 6;
+}
+
+/**
+ * \brief 用一种颜色绘制已添加的矩形
+ */
+static void guiHudFlush(GUIhud *hud, const float *color)
+{
+    if (hud->vertexCount == 0)
+        return;
+
+    guiShaderUniformFromID(hud->colorLoc, 4f, color[0], color[1], color[2], color[3]);
+    glBufferData(GL_ARRAY_BUFFER, hud->vertexCount * 3 * sizeof(float), hud->vertices, GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, hud->vertexCount);
+    hud->vertexCount = 0;
+}
+
+void guiWidgetHudToggle(GUIwin *win, GUIwidget *widget)
+{
+    GUIhud *hud = (GUIhud *)widget->data;
+    if (hud == NULL)
+        return;
+
+    // 显示时才让窗口统计耗时
+    if (win->hud == NULL)
+    {
+        memset(hud->frame, 0, sizeof(hud->frame));
+        memset(hud->history, 0, sizeof(hud->history));
+        hud->widgetCount = 0;
+        win->hud = hud;
+    }
+    else
+    {
+        win->hud = NULL;
+    }
+    guiWidgetMarkDirty(widget, NULL);
+}
+
+void guiWidgetHudInit(GUIwin *win, GUIwidget *widget)
+{
+    GUIhud *hud = (GUIhud *)calloc(1, sizeof(GUIhud));
+    if (hud == NULL)
+    {
+        ERROR("性能统计控件创建失败\n");
+        return;
+    }
+
+    // 着色器已经编译进程序
+    uint8_t *vs = NULL, *fs = NULL;
+    size_t vsSize, fsSize;
+    resGetFile("r.vert", &vs, &vsSize, true);
+    resGetFile("r.frag", &fs, &fsSize, true);
+    hud->program = vs && fs ? guiShaderCreateProgram((const char *)vs, (const char *)fs, NULL) : 0;
+    if (vs)
+        resRelease("r.vert");
+    if (fs)
+        resRelease("r.frag");
+    if (hud->program == 0)
+    {
+        ERROR("性能统计控件的着色器创建失败\n");
+        free(hud);
+        return;
+    }
+    hud->colorLoc = guiShaderUniformGetLocation(hud->program, "color");
+
+    // 顶点
+    hud->vertexMax = (GUI_HUD_HISTORY + GUI_HUD_WIDGETS + 2) * 6;
+    hud->vertices = (float *)malloc(hud->vertexMax * 3 * sizeof(float));
+    glGenVertexArrays(1, &hud->VAO);
+    glGenBuffers(1, &hud->VBO);
+    glBindVertexArray(hud->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, hud->VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    // GPU查询
+    glGenQueries(GUI_HUD_QUERIES, hud->queries);
+
+    widget->data = hud;
+    guiWidgetSetRect(widget, HUD_X, HUD_Y, HUD_W, HUD_H);
+}
+
+void guiWidgetHudDestroy(GUIwin *win, GUIwidget *widget)
+{
+    GUIhud *hud = (GUIhud *)widget->data;
+    if (hud == NULL)
+        return;
+
+    if (win->hud == hud)
+        win->hud = NULL;
+
+    glDeleteQueries(GUI_HUD_QUERIES, hud->queries);
+    glDeleteBuffers(1, &hud->VBO);
+    glDeleteVertexArrays(1, &hud->VAO);
+    guiShaderDelete(hud->program);
+    free(hud->vertices);
+    free(hud);
+    widget->data = NULL;
+}
+
+bool guiWidgetHudDraw(GUIwin *win, GUIwidget *widget)
+{
+    GUIhud *hud = (GUIhud *)widget->data;
+    if (hud == NULL || win->hud != hud || hud->vertices == NULL)
+        return true;
+
+    // 顶点已经是PV的坐标
+    mat4 model = GLM_MAT4_IDENTITY_INIT;
+    guiShaderUse(hud->program);
+    guiShaderUniformMatrix(hud->program, "PV", 4fv, (float *)PV);
+    guiShaderUniformMatrix(hud->program, "model", 4fv, (float *)model);
+    glBindVertexArray(hud->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, hud->VBO);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // 背景
+    guiHudQuad(hud, win, HUD_X, HUD_Y, HUD_W, HUD_H);
+    guiHudFlush(hud, (const float[4]){0.0f, 0.0f, 0.0f, 0.6f});
+
+    // CPU耗时, 从下往上依次为事件分发, 绘制回调, 交换缓冲区; 最旧的帧在左边
+    float left = HUD_X + HUD_PAD, bottom = HUD_Y + HUD_PAD + HUD_GRAPH;
+    float scale = (float)(HUD_GRAPH / GUI_HUD_SCALE);
+    float base[GUI_HUD_HISTORY] = {0};
+    for (int part = GUI_HUD_DISPATCH; part <= GUI_HUD_SWAP; part++)
+    {
+        for (int i = 0; i < GUI_HUD_HISTORY; i++)
+        {
+            const float *t = hud->history[(hud->historyIndex + i) % GUI_HUD_HISTORY];
+            float h = fminf(t[part] * scale, HUD_GRAPH - base[i]);
+            guiHudQuad(hud, win, left + i * HUD_COLUMN, bottom - base[i] - h, HUD_COLUMN, h);
+            base[i] += h;
+        }
+        guiHudFlush(hud, guiHudColor[part]);
+    }
+
+    // GPU耗时, 每帧一个标记
+    for (int i = 0; i < GUI_HUD_HISTORY; i++)
+    {
+        const float *t = hud->history[(hud->historyIndex + i) % GUI_HUD_HISTORY];
+        float y = fminf(t[GUI_HUD_GPU] * scale, HUD_GRAPH);
+        if (t[GUI_HUD_GPU] > 0)
+            guiHudQuad(hud, win, left + i * HUD_COLUMN, bottom - y - 1, HUD_COLUMN, 2);
+    }
+    guiHudFlush(hud, guiHudColor[GUI_HUD_GPU]);
+
+    // 帧间隔
+    float budget = fminf((float)(1.0 / win->frame.rate) * scale, HUD_GRAPH);
+    guiHudQuad(hud, win, left, bottom - budget, GUI_HUD_HISTORY * HUD_COLUMN, 1);
+    guiHudFlush(hud, (const float[4]){1.0f, 0.9f, 0.2f, 1.0f});
+
+    // 各个控件的绘制耗时, 宽度与图表高度使用相同的比例
+    for (int i = 0; i < hud->widgetCount; i++)
+    {
+        float w = fminf((float)hud->widgets[i].avg * scale, GUI_HUD_HISTORY * HUD_COLUMN);
+        guiHudQuad(hud, win, left, bottom + HUD_PAD + i * HUD_ROW, fmaxf(w, 1), HUD_ROW - 2);
+    }
+    guiHudFlush(hud, (const float[4]){1.0f, 0.6f, 0.2f, 1.0f});
+
+    glDisable(GL_BLEND);
+    glBindVertexArray(0);
+
+    // 显示时每帧都需要重绘
+    guiWidgetMarkDirty(widget, NULL);
+    return true;
+}
+
+bool guiWidgetHudEvent(GUIwin *win, GUIwidget *widget, const GUIevent *event)
+{
+    if (event->type == GUI_EVENT_TYPE_CHAR_MODS && event->CharMods.codepoint == GUI_HUD_KEY)
+        guiWidgetHudToggle(win, widget);
+
+    return true;
+}
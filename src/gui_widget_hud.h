@@ -0,0 +1,123 @@
+/**
+ * \file gui_widget_hud.h
+ * \brief GUI 性能统计控件
+ *
+ * 在窗口左上角显示最近各帧的耗时图表: CPU耗时分为事件分发, 绘制回调和交换缓冲区,
+ * GPU耗时来自GL_TIME_ELAPSED查询, 下方为各个控件的绘制耗时.
+ * 显示时窗口才统计耗时(win->hud不为NULL), 隐藏时没有额外开销.
+ *
+ * 按GUI_HUD_KEY或调用guiWidgetHudToggle切换显示.
+ * 程序不带字体, 各部分耗时的数值每秒输出一行到日志
+ */
+
+#ifndef GUI_WIDGET_HUD_H
+#define GUI_WIDGET_HUD_H
+
+#include <glad.h>
+#include <cglm/cglm.h>
+#include <GLFW/glfw3.h>
+#include <stb_truetype.h>
+
+#include "gui_window.h"
+#include "gui_widget.h"
+#include "gui_widgetID.h"
+
+#define GUI_HUD_KEY L'`'     // 切换显示的按键
+#define GUI_HUD_HISTORY 120  // 图表显示的帧数
+#define GUI_HUD_WIDGETS 8    // 显示绘制耗时的控件数量
+#define GUI_HUD_QUERIES 4    // GPU查询数量, 结果延迟几帧读取
+#define GUI_HUD_SCALE 0.0333 // 图表高度对应的耗时(秒)
+
+typedef struct _GUIwin GUIwin;
+typedef struct _GUIevent GUIevent;
+typedef struct _GUIwidget GUIwidget;
+
+// 耗时的分类
+enum
+{
+    GUI_HUD_DISPATCH, // 事件分发
+    GUI_HUD_DRAW,     // 绘制回调
+    GUI_HUD_SWAP,     // 交换缓冲区
+    GUI_HUD_GPU,      // GPU
+    GUI_HUD_NUM
+};
+
+/**
+ * \brief 单个控件的绘制耗时
+ */
+typedef struct
+{
+    GUIwidget *widget; // 控件, 只用于比较, 控件移除后不再访问
+    uint64_t id;       // 控件ID
+    double frame;      // 当前帧的耗时(秒)
+    double avg;        // 平滑后的耗时(秒)
+} GUIhudWidget;
+
+/**
+ * \brief 性能统计数据, 由窗口在每帧中写入
+ */
+typedef struct _GUIhud
+{
+    double frame[GUI_HUD_NUM];                   // 当前帧各部分的耗时(秒)
+    float history[GUI_HUD_HISTORY][GUI_HUD_NUM]; // 最近各帧的耗时(秒), 环形缓冲区
+    int historyIndex;                            // 下一帧写入的位置
+
+    GUIhudWidget widgets[GUI_HUD_WIDGETS]; // 控件的绘制耗时
+    int widgetCount;                       // 控件数量
+
+    GLuint queries[GUI_HUD_QUERIES];    // GPU查询
+    bool queryPending[GUI_HUD_QUERIES]; // 查询结果是否未读取
+    bool queryActive;                   // 当前帧是否开始了查询
+    int queryIndex;                     // 下一个使用的查询
+    double gpu;                         // 最近读取的GPU耗时(秒)
+
+    double logTime; // 上次输出日志的时间
+
+    // 渲染
+    GLuint program;  // 着色器程序
+    GLuint VAO, VBO; // 顶点
+    GLint colorLoc;  // 颜色位置
+    float *vertices; // 同一颜色的顶点
+    int vertexCount; // 顶点数量
+    int vertexMax;   // 最大顶点数量
+} GUIhud;
+
+/**
+ * \brief 记录控件的绘制耗时, 由窗口调用
+ * \param hud 性能统计数据
+ * \param widget 控件
+ * \param time 耗时(秒)
+ */
+void guiHudWidgetTime(GUIhud *hud, GUIwidget *widget, double time);
+
+/**
+ * \brief 开始GPU计时, 由窗口在绘制回调之前调用
+ * \param hud 性能统计数据
+ */
+void guiHudGpuBegin(GUIhud *hud);
+
+/**
+ * \brief 结束GPU计时, 由窗口在绘制回调之后调用
+ * \param hud 性能统计数据
+ */
+void guiHudGpuEnd(GUIhud *hud);
+
+/**
+ * \brief 结束一帧, 由窗口在交换缓冲区之后调用
+ * \param hud 性能统计数据
+ */
+void guiHudFrameEnd(GUIhud *hud);
+
+/**
+ * \brief 切换性能统计的显示
+ * \param win 窗口控制器
+ * \param widget 性能统计控件
+ */
+void guiWidgetHudToggle(GUIwin *win, GUIwidget *widget);
+
+void guiWidgetHudInit(GUIwin *win, GUIwidget *widget);
+void guiWidgetHudDestroy(GUIwin *win, GUIwidget *widget);
+bool guiWidgetHudDraw(GUIwin *win, GUIwidget *widget);
+bool guiWidgetHudEvent(GUIwin *win, GUIwidget *widget, const GUIevent *event);
+
+#endif // GUI_WIDGET_HUD_H
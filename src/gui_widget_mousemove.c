@@ -11,7 +11,8 @@ bool guiWidgetMouseMoveEvent(GUIwin *win, GUIwidget *widget, const GUIevent *eve
             if (event->MouseButton.action == GLFW_PRESS)
             {
                 move = true;
-                glfwGetCursorPos(win->window, &xpos_old, &ypos_old);
+                xpos_old = event->MouseButton.xpos;
+                ypos_old = event->MouseButton.ypos;
             }
             else if (event->MouseButton.action == GLFW_RELEASE)
             {
@@ -1,4 +1,6 @@
 #include "gui_window.h"
+#include "gui_widget_hud.h"
+#include "trace.h"
 
 void guiWindowInit(GUIwin *win, GLFWwindow *window)
 {
@@ -9,22 +11,79 @@ void guiWindowInit(GUIwin *win, GLFWwindow *window)
     glfwSetWindowUserPointer(window, win);
 
     // 任务初始化
-    sem_init(&win->semTask, 0, 0);
-    listInitList(&win->listTask);
-    pthread_mutex_init(&win->mutexTask, NULL);
+    mpscInit(&win->queueTask);
 
     // 列表初始化
     for (int i = 0; i < GUI_CALL_PRIORITY_NUM; i++)
     {
-        listInitList(&win->listDraw[i]);
-        listInitList(&win->listEventMouseButton[i]);
-        listInitList(&win->listEventCursorPos[i]);
-        listInitList(&win->listEventCharMods[i]);
-        listInitList(&win->listEventScroll[i]);
+        ilistInit(&win->listDraw[i]);
+        ilistInit(&win->listEventMouseButton[i]);
+        ilistInit(&win->listEventCursorPos[i]);
+        ilistInit(&win->listEventCharMods[i]);
+        ilistInit(&win->listEventScroll[i]);
     }
 
     // 控件列表初始化
     listInitList(&win->listWidget);
+
+    // 命中测试网格覆盖整个窗口
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+    guiHitInit(&win->hit, width, height);
+
+    // 帧调度
+    guiFrameInit(&win->frame, GUI_FRAME_RATE, GUI_FRAME_VSYNC);
+
+    // 第一帧重绘整个窗口
+    guiWindowDamage(win, NULL);
+}
+
+void guiWindowDamage(GUIwin *win, const GUIrect *rect)
+{
+    GUIrect full = {0};
+    if (rect == NULL)
+    {
+        int width, height;
+        glfwGetWindowSize(win->window, &width, &height);
+        full = (GUIrect){0, 0, width, height};
+        rect = &full;
+    }
+    win->damage = guiRectUnion(&win->damage, rect);
+}
+
+void guiWindowAttachPointer(GUIwin *win, GUIwidget *widget)
+{
+    // 有命中区域的控件登记到网格中
+    if (guiRectEmpty(&widget->rect) == false)
+    {
+        if (widget->priorityEventMouseButton >= 0 || widget->priorityEventCursorPos >= 0 ||
+            widget->priorityEventScroll >= 0)
+            guiHitInsert(&win->hit, widget);
+        return;
+    }
+
+    // 添加鼠标事件列表
+    if (widget->priorityEventMouseButton >= 0)
+        ilistAddTail(&win->listEventMouseButton[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityEventMouseButton)],
+                     &widget->linkEventMouseButton);
+
+    // 添加光标事件列表
+    if (widget->priorityEventCursorPos >= 0)
+        ilistAddTail(&win->listEventCursorPos[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityEventCursorPos)],
+                     &widget->linkEventCursorPos);
+
+    // 添加滚轮事件列表
+    if (widget->priorityEventScroll >= 0)
+        ilistAddTail(&win->listEventScroll[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityEventScroll)],
+                     &widget->linkEventScroll);
+}
+
+void guiWindowDetachPointer(GUIwin *win, GUIwidget *widget)
+{
+    ilistRemove(&widget->linkEventMouseButton);
+    ilistRemove(&widget->linkEventCursorPos);
+    ilistRemove(&widget->linkEventScroll);
+    guiHitRemove(&win->hit, widget);
 }
 
 void guiWindowAddWidget(GUIwin *win, uint64_t id)
@@ -41,33 +100,32 @@ void guiWindowAddWidget(GUIwin *win, uint64_t id)
     // 绑定窗口
     widget->win = win;
 
-    // 添加到控件列表
-    listAddNodeInEnd(&win->listWidget, listDataToNode(listCreateNode(), widget, 0, false));
+    // 添加到控件列表, 保存节点用于移除
+    widget->nodeWidget = listDataToNode(listCreateNode(), widget, 0, false);
+    if (widget->nodeWidget == NULL)
+    {
+        ERROR("ID为:%llu的控件添加失败\n", (unsigned long long)id);
+        widget->win = NULL;
+        return;
+    }
+    listAddNodeInEnd(&win->listWidget, widget->nodeWidget);
+    widget->seq = ++win->seq;
 
     // 添加渲染列表
     if (widget->priorityDraw >= 0)
-        listAddNodeInEnd(&win->listDraw[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityDraw)],
-                         listDataToNode(listCreateNode(), widget, 0, false));
+        ilistAddTail(&win->listDraw[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityDraw)], &widget->linkDraw);
 
-    // 添加鼠标事件列表
-    if (widget->priorityEventMouseButton >= 0)
-        listAddNodeInEnd(&win->listEventMouseButton[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityEventMouseButton)],
-                         listDataToNode(listCreateNode(), widget, 0, false));
+    // 添加指针事件列表或命中测试网格
+    guiWindowAttachPointer(win, widget);
 
-    // 添加光标事件列表
-    if (widget->priorityEventCursorPos >= 0)
-        listAddNodeInEnd(&win->listEventCursorPos[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityEventCursorPos)],
-                         listDataToNode(listCreateNode(), widget, 0, false));
+    // 新控件需要绘制
+    if (widget->priorityDraw >= 0)
+        guiWidgetMarkDirty(widget, NULL);
 
     // 添加字符事件列表
     if (widget->priorityEventCharMods >= 0)
-        listAddNodeInEnd(&win->listEventCharMods[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityEventCharMods)],
-                         listDataToNode(listCreateNode(), widget, 0, false));
-
-    // 添加滚轮事件列表
-    if (widget->priorityEventScroll >= 0)
-        listAddNodeInEnd(&win->listEventScroll[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityEventScroll)],
-                         listDataToNode(listCreateNode(), widget, 0, false));
+        ilistAddTail(&win->listEventCharMods[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityEventCharMods)],
+                     &widget->linkEventCharMods);
 
     // 调用初始化函数
     CALL(widget->init, win, widget);
@@ -89,121 +147,334 @@ void guiWindowRemoveWidget(GUIwin *win, uint64_t id)
     if (widget->win != win)
         return;
 
+    // 控件原来的区域需要重绘
+    if (widget->priorityDraw >= 0)
+        guiWidgetMarkDirty(widget, NULL);
+
     // 解绑窗口
     widget->win = NULL;
 
-    // 移除控件列表
-    list *l = &win->listWidget;
-    list *node = listSearchDataAddr(l, widget);
-    if (node != NULL)
-        listDeleteNode(l, node, NULL);
+    // 移除控件列表, 直接使用保存的节点
+    if (widget->nodeWidget != NULL)
+        listDeleteNode(&win->listWidget, widget->nodeWidget, NULL);
     else
-        ERROR("没有找到ID为:%lld的控件\n", id);
+        ERROR("没有找到ID为:%llu的控件\n", (unsigned long long)id);
+    widget->nodeWidget = NULL;
 
     // 移除渲染列表
-    if (widget->priorityDraw >= 0)
+    ilistRemove(&widget->linkDraw);
+
+    // 移除指针事件列表和命中测试网格
+    guiWindowDetachPointer(win, widget);
+
+    // 移除字符事件列表
+    if (widget->priorityEventCharMods >= 0 && ilistEmpty(&widget->linkEventCharMods))
+        ERROR("没有找到ID为:%llu的控件的字符事件回调函数\n", (unsigned long long)id);
+    ilistRemove(&widget->linkEventCharMods);
+
+    // 调用销毁函数
+    CALL(widget->destroy, win, widget);
+}
+
+bool guiWindowPostTask(GUIwin *win, void (*fun)(GUIwin *win, void *arg), void *arg)
+{
+    if (win == NULL || fun == NULL)
+        return false;
+
+    GUItask *task = (GUItask *)malloc(sizeof(GUItask));
+    if (task == NULL)
+        return false;
+
+    task->fun = fun;
+    task->arg = arg;
+    mpscPush(&win->queueTask, &task->node);
+
+    // 唤醒主线程
+    glfwPostEmptyEvent();
+
+    return true;
+}
+
+bool guiWindowDoTask(GUIwin *win, double budget)
+{
+    TRACE_ZONE("guiWindowDoTask");
+    double end = glfwGetTime() + budget;
+
+    mpscNode *node;
+    while ((node = mpscPop(&win->queueTask)) != NULL)
+    {
+        GUItask *task = MPSC_CONTAINER(node, GUItask, node);
+        task->fun(win, task->arg);
+        free(task);
+
+        // 超出预算, 剩余任务留到下一次循环
+        if (budget > 0 && glfwGetTime() >= end)
+            break;
+    }
+
+    return mpscEmpty(&win->queueTask) == false;
+}
+
+/**
+ * \brief 获取至少能放下need个控件的临时缓冲区, 回调函数可能增删控件, 调用前先复制要调用的控件
+ * \param win 窗口控制器
+ * \param need 控件数量
+ * \return 缓冲区, 内存不足时返回NULL
+ */
+static GUIwidget **guiWindowScratch(GUIwin *win, int need)
+{
+    if (need > win->hitCap)
+    {
+        int cap = win->hitCap ? win->hitCap : 16;
+        while (cap < need)
+            cap *= 2;
+        GUIwidget **buf = (GUIwidget **)realloc(win->hitBuf, sizeof(GUIwidget *) * cap);
+        if (buf == NULL)
+        {
+            ERROR("控件回调失败, 内存不足\n");
+            return NULL;
+        }
+        win->hitBuf = buf;
+        win->hitCap = cap;
+    }
+    return win->hitBuf;
+}
+
+/**
+ * \brief 复制一个优先级列表中的控件
+ * \param win 窗口控制器
+ * \param l 列表
+ * \param link 链接在控件中的偏移
+ * \param count 控件数量
+ * \return 控件, 内存不足时返回NULL
+ */
+static GUIwidget **guiWindowSnapshot(GUIwin *win, ilist *l, size_t link, int *count)
+{
+    int need = 0;
+    ILIST_FOR_EACH(node, l)
+        need++;
+
+    *count = 0;
+    GUIwidget **widgets = guiWindowScratch(win, need);
+    if (widgets)
+        ILIST_FOR_EACH(node, l)
+            widgets[(*count)++] = (GUIwidget *)((char *)node - link);
+    return widgets;
+}
+
+void guiWindowDrawCallBack(ilist *group, GUIwin *win)
+{
+    bool over = false;
+    for (int i = 0; i < GUI_CALL_PRIORITY_NUM && over == false; i++)
     {
-        list *l = &win->listDraw[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityDraw)];
-        list *tmp = l->fd;
-        while (tmp != l)
+        // 先复制再调用, 回调函数移除的控件不再调用
+        int count;
+        GUIwidget **widgets = guiWindowSnapshot(win, &group[i], offsetof(GUIwidget, linkDraw), &count);
+        for (int j = 0; j < count; j++)
         {
-            if (tmp->data == widget)
+            GUIwidget *widget = widgets[j];
+            if (widget->win != win)
+                continue;
+
+            bool next;
+            if (win->hud)
             {
-                listDeleteNode(l, tmp, NULL);
-                break;
+                // 显示性能统计时记录每个控件的耗时
+                double start = glfwGetTime();
+                next = widget->callDraw(win, widget);
+                guiHudWidgetTime(win->hud, widget, glfwGetTime() - start);
+            }
+            else
+            {
+                next = widget->callDraw(win, widget);
             }
-            tmp = tmp->fd;
+            if (next == false)
+                over = true; // 相同优先级的都需要调用
         }
     }
+}
 
-    // 移除鼠标事件列表
-    if (widget->priorityEventMouseButton >= 0)
+/**
+ * \brief 按优先级调用事件回调函数
+ * \param group 事件列表
+ * \param link 链接在控件中的偏移, 如offsetof(GUIwidget, linkEventScroll)
+ * \param win 窗口控制器
+ * \param event 事件
+ */
+void guiWindowEventCallBack(ilist *group, size_t link, GUIwin *win, const GUIevent *event)
+{
+    bool over = false;
+    for (int i = 0; i < GUI_CALL_PRIORITY_NUM && over == false; i++)
     {
-        list *l = &win->listEventMouseButton[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityEventMouseButton)];
-        list *node = listSearchDataAddr(l, widget);
-        if (node != NULL)
-            listDeleteNode(l, node, NULL);
-        else
-            ERROR("没有找到ID为:%lld的控件的鼠标事件回调函数\n", id);
+        // 先复制再调用, 回调函数移除的控件不再调用
+        int count;
+        GUIwidget **widgets = guiWindowSnapshot(win, &group[i], link, &count);
+        for (int j = 0; j < count; j++)
+        {
+            GUIwidget *widget = widgets[j];
+            if (widget->win == win && widget->callEvent(win, widget, event) == false)
+                over = true; // 相同优先级的都需要调用
+        }
     }
+}
 
-    // 移除光标事件列表
-    if (widget->priorityEventCursorPos >= 0)
+/**
+ * \brief 控件对指针事件的优先级
+ */
+static int guiWindowPointerPriority(const GUIwidget *widget, uint64_t type)
+{
+    switch (type)
     {
-        list *l = &win->listEventCursorPos[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityEventCursorPos)];
-        list *node = listSearchDataAddr(l, widget);
-        if (node != NULL)
-            listDeleteNode(l, node, NULL);
-        else
-            ERROR("没有找到ID为:%lld的控件的光标事件回调函数\n", id);
+    case GUI_EVENT_TYPE_MOUSE_BUTTON:
+        return widget->priorityEventMouseButton;
+    case GUI_EVENT_TYPE_CURSOR_POS:
+        return widget->priorityEventCursorPos;
+    case GUI_EVENT_TYPE_SCROLL:
+        return widget->priorityEventScroll;
+    default:
+        return -1;
     }
+}
 
-    // 移除字符事件列表
-    if (widget->priorityEventCharMods >= 0)
+/**
+ * \brief 分发指针事件, 只调用没有命中区域的控件和命中区域包含光标的控件
+ * \param group 指针事件列表(没有命中区域的控件)
+ * \param link 链接在控件中的偏移
+ * \param win 窗口控制器
+ * \param event 事件
+ * \param x 光标X坐标
+ * \param y 光标Y坐标
+ */
+void guiWindowPointerCallBack(ilist *group, size_t link, GUIwin *win, const GUIevent *event, double x, double y)
+{
+    // 需要的容量: 没有命中区域的控件和光标所在网格中的控件
+    int need = guiHitCount(&win->hit, x, y);
+    for (int i = 0; i < GUI_CALL_PRIORITY_NUM; i++)
+        ILIST_FOR_EACH(node, &group[i])
+            need++;
+    GUIwidget **hits = guiWindowScratch(win, need);
+    if (hits == NULL)
+        return;
+    int count = 0;
+
+    // 没有命中区域的控件
+    for (int i = 0; i < GUI_CALL_PRIORITY_NUM; i++)
+        ILIST_FOR_EACH(node, &group[i])
+            hits[count++] = (GUIwidget *)((char *)node - link);
+
+    // 命中区域包含光标的控件, 只检查光标所在的网格
+    int n = guiHitQuery(&win->hit, x, y, hits + count, win->hitCap - count);
+    GUIwidget **found = hits + count;
+    for (int i = 0; i < n; i++)
+        if (guiWindowPointerPriority(found[i], event->type) >= 0)
+            hits[count++] = found[i];
+
+    // 按优先级和添加顺序排序, 与遍历优先级列表的顺序相同
+    for (int i = 1; i < count; i++)
     {
-        list *l = &win->listEventCharMods[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityEventCharMods)];
-        list *node = listSearchDataAddr(l, widget);
-        if (node != NULL)
-            listDeleteNode(l, node, NULL);
-        else
-            ERROR("没有找到ID为:%lld的控件的字符事件回调函数\n", id);
+        GUIwidget *widget = hits[i];
+        int priority = GUI_CALL_PRIORITY_SAFE_GET(guiWindowPointerPriority(widget, event->type));
+        int j = i - 1;
+        while (j >= 0)
+        {
+            int p = GUI_CALL_PRIORITY_SAFE_GET(guiWindowPointerPriority(hits[j], event->type));
+            if (p < priority || (p == priority && hits[j]->seq < widget->seq))
+                break;
+            hits[j + 1] = hits[j];
+            j--;
+        }
+        hits[j + 1] = widget;
     }
 
-    // 移除滚轮事件列表
-    if (widget->priorityEventScroll >= 0)
+    // 相同优先级的都需要调用, 之后不再调用更低优先级的控件
+    int stop = GUI_CALL_PRIORITY_NUM;
+    for (int i = 0; i < count; i++)
     {
-        list *l = &win->listEventScroll[GUI_CALL_PRIORITY_SAFE_GET(widget->priorityEventScroll)];
-        list *node = listSearchDataAddr(l, widget);
-        if (node != NULL)
-            listDeleteNode(l, node, NULL);
-        else
-            ERROR("没有找到ID为:%lld的控件的滚轮事件回调函数\n", id);
+        GUIwidget *widget = hits[i];
+        if (GUI_CALL_PRIORITY_SAFE_GET(guiWindowPointerPriority(widget, event->type)) > stop)
+            break;
+        // 之前的回调函数可能移除了这个控件
+        if (widget->win != win)
+            continue;
+        if (widget->callEvent(win, widget, event) == false && stop == GUI_CALL_PRIORITY_NUM)
+            stop = GUI_CALL_PRIORITY_SAFE_GET(guiWindowPointerPriority(widget, event->type));
     }
-
-    // 调用销毁函数
-    CALL(widget->destroy, win, widget);
 }
 
-void guiWindowDrawCallBack(list *group, GUIwin *win)
+/**
+ * \brief 事件写入环形缓冲区
+ *
+ * 连续的光标事件只保留最后的位置, 连续的滚轮事件累加偏移,
+ * 中间有其他事件时不合并, 保证事件顺序不变
+ * \param win 窗口控制器
+ * \param event 事件
+ * \param x 事件发生时的光标X坐标
+ * \param y 事件发生时的光标Y坐标
+ */
+static void guiWindowPushEvent(GUIwin *win, const GUIevent *event, double x, double y)
 {
-    bool over = false;
-    for (int i = 0; i < GUI_CALL_PRIORITY_NUM && over == false; i++)
+    // 与最后一个未分发的同类事件合并
+    if (win->ringTail != win->ringHead &&
+        (event->type == GUI_EVENT_TYPE_CURSOR_POS || event->type == GUI_EVENT_TYPE_SCROLL))
     {
-        // 如果没有控件，直接跳过
-        if (group[i].count == 0)
-            continue;
-
-        // 遍历所有控件
-        list *l = &group[i];
-        list *node = l->fd;
-        while (node != l)
+        GUIeventSlot *last = &win->ring[(win->ringTail - 1) & (GUI_EVENT_RING - 1)];
+        if (last->event.type == event->type)
         {
-            GUIwidget *widget = (GUIwidget *)node->data;
-            if (widget->callDraw(win, widget) == false)
-                over = true; // 相同优先级的都需要调用
-            node = node->fd;
+            if (event->type == GUI_EVENT_TYPE_CURSOR_POS)
+            {
+                last->event.CursorPos = event->CursorPos;
+            }
+            else
+            {
+                last->event.Scroll.xoffset += event->Scroll.xoffset;
+                last->event.Scroll.yoffset += event->Scroll.yoffset;
+            }
+            last->x = x;
+            last->y = y;
+            return;
         }
     }
+
+    // 缓冲区满时先分发已有的事件
+    if (win->ringTail - win->ringHead == GUI_EVENT_RING)
+        guiWindowDispatchEvents(win);
+
+    GUIeventSlot *slot = &win->ring[win->ringTail & (GUI_EVENT_RING - 1)];
+    slot->event = *event;
+    slot->x = x;
+    slot->y = y;
+    win->ringTail++;
 }
 
-void guiWindowEventCallBack(list *group, GUIwin *win, const GUIevent *event)
+void guiWindowDispatchEvents(GUIwin *win)
 {
-    bool over = false;
-    for (int i = 0; i < GUI_CALL_PRIORITY_NUM && over == false; i++)
+    TRACE_ZONE("guiWindowDispatchEvents");
+
+    uint32_t end = win->ringTail;
+    while (win->ringHead != end)
     {
-        // 如果没有控件，直接跳过
-        if (group[i].count == 0)
-            continue;
+        // 先取出再分发, 回调中产生的事件不会与正在分发的事件合并
+        GUIeventSlot slot = win->ring[win->ringHead & (GUI_EVENT_RING - 1)];
+        win->ringHead++;
 
-        // 遍历所有控件
-        list *l = &group[i];
-        list *node = l->fd;
-        while (node != l)
+        const GUIevent *event = &slot.event;
+        switch (event->type)
         {
-            GUIwidget *widget = (GUIwidget *)node->data;
-            if (widget->callEvent(win, widget, event) == false)
-                over = true; // 相同优先级的都需要调用
-            node = node->fd;
+        case GUI_EVENT_TYPE_MOUSE_BUTTON:
+            guiWindowPointerCallBack(win->listEventMouseButton, offsetof(GUIwidget, linkEventMouseButton), win,
+                                     event, slot.x, slot.y);
+            break;
+        case GUI_EVENT_TYPE_CURSOR_POS:
+            guiWindowPointerCallBack(win->listEventCursorPos, offsetof(GUIwidget, linkEventCursorPos), win,
+                                     event, slot.x, slot.y);
+            break;
+        case GUI_EVENT_TYPE_CHAR_MODS:
+            guiWindowEventCallBack(win->listEventCharMods, offsetof(GUIwidget, linkEventCharMods), win, event);
+            break;
+        case GUI_EVENT_TYPE_SCROLL:
+            guiWindowPointerCallBack(win->listEventScroll, offsetof(GUIwidget, linkEventScroll), win,
+                                     event, slot.x, slot.y);
+            break;
         }
     }
 }
@@ -220,9 +491,10 @@ void guiWindowMouseButtonCallback(GLFWwindow *window, int button, int action, in
     event.MouseButton.button = button;
     event.MouseButton.action = action;
     event.MouseButton.mods = mods;
+    glfwGetCursorPos(window, &event.MouseButton.xpos, &event.MouseButton.ypos);
 
-    // 调用事件回调函数
-    guiWindowEventCallBack(win->listEventMouseButton, win, (const GUIevent *)&event);
+    // 写入事件缓冲
+    guiWindowPushEvent(win, &event, event.MouseButton.xpos, event.MouseButton.ypos);
 }
 
 void guiWindowCursorPosCallback(GLFWwindow *window, double xpos, double ypos)
@@ -237,8 +509,8 @@ void guiWindowCursorPosCallback(GLFWwindow *window, double xpos, double ypos)
     event.CursorPos.xpos = xpos;
     event.CursorPos.ypos = ypos;
 
-    // 调用事件回调函数
-    guiWindowEventCallBack(win->listEventCursorPos, win, (const GUIevent *)&event);
+    // 写入事件缓冲
+    guiWindowPushEvent(win, &event, xpos, ypos);
 }
 
 void guiWindowCharModsCallback(GLFWwindow *window, unsigned int codepoint, int mods)
@@ -253,8 +525,8 @@ void guiWindowCharModsCallback(GLFWwindow *window, unsigned int codepoint, int m
     event.CharMods.codepoint = codepoint;
     event.CharMods.mods = mods;
 
-    // 调用事件回调函数
-    guiWindowEventCallBack(win->listEventCharMods, win, (const GUIevent *)&event);
+    // 写入事件缓冲, 字符事件不需要光标位置
+    guiWindowPushEvent(win, &event, 0, 0);
 }
 
 void guiWindowScrollCallback(GLFWwindow *window, double xoffset, double yoffset)
@@ -269,8 +541,137 @@ void guiWindowScrollCallback(GLFWwindow *window, double xoffset, double yoffset)
     event.Scroll.xoffset = xoffset;
     event.Scroll.yoffset = yoffset;
 
-    // 调用事件回调函数
-    guiWindowEventCallBack(win->listEventScroll, win, (const GUIevent *)&event);
+    // 写入事件缓冲
+    double x, y;
+    glfwGetCursorPos(window, &x, &y);
+    guiWindowPushEvent(win, &event, x, y);
+}
+
+void guiWindowRefreshCallback(GLFWwindow *window)
+{
+    GUIwin *win = (GUIwin *)glfwGetWindowUserPointer(window);
+    if (win == NULL)
+        return;
+
+    // 窗口内容被系统丢弃(如被遮挡后恢复), 重绘整个窗口
+    guiWindowDamage(win, NULL);
+}
+
+/**
+ * \brief 按帧缓冲大小创建或重建离屏帧缓冲
+ * \param win 窗口控制器
+ * \param fbWidth 帧缓冲宽度(像素)
+ * \param fbHeight 帧缓冲高度(像素)
+ * \return 离屏帧缓冲的内容是否无效(刚创建或不可用), 需要重绘整个窗口
+ */
+static bool guiWindowTarget(GUIwin *win, int fbWidth, int fbHeight)
+{
+    if (win->fbo && win->fboWidth == fbWidth && win->fboHeight == fbHeight)
+        return false;
+
+    if (win->fbo)
+    {
+        glDeleteFramebuffers(1, &win->fbo);
+        glDeleteRenderbuffers(1, &win->fboColor);
+        win->fbo = 0;
+        win->fboColor = 0;
+    }
+    win->fboWidth = fbWidth;
+    win->fboHeight = fbHeight;
+    if (fbWidth <= 0 || fbHeight <= 0)
+        return true;
+
+    glGenRenderbuffers(1, &win->fboColor);
+    glBindRenderbuffer(GL_RENDERBUFFER, win->fboColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, fbWidth, fbHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &win->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, win->fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, win->fboColor);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        ERROR("离屏帧缓冲创建失败, 每帧重绘整个窗口\n");
+        glDeleteFramebuffers(1, &win->fbo);
+        glDeleteRenderbuffers(1, &win->fboColor);
+        win->fbo = 0;
+        win->fboColor = 0;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return true;
+}
+
+/**
+ * \brief 重绘需要重绘的区域
+ *
+ * 只重绘离屏帧缓冲中需要重绘的区域, 再把整个离屏帧缓冲复制到默认帧缓冲后交换,
+ * 不依赖交换后后缓冲区的内容(交换方式可能是复制, 翻转或丢弃)
+ * \param win 窗口控制器
+ */
+static void guiWindowDraw(GUIwin *win)
+{
+    TRACE_ZONE("guiWindowDraw");
+
+    int width, height, fbWidth, fbHeight;
+    glfwGetWindowSize(win->window, &width, &height);
+    glfwGetFramebufferSize(win->window, &fbWidth, &fbHeight);
+
+    // 绘制回调中标记的区域留到下一帧
+    GUIrect damage = win->damage;
+    win->damage = (GUIrect){0};
+
+    // 离屏帧缓冲刚创建或大小改变时重绘整个窗口
+    if (guiWindowTarget(win, fbWidth, fbHeight) || win->fbo == 0)
+        damage = (GUIrect){0, 0, width, height};
+
+    // 裁剪到窗口内
+    double x0 = fmax(damage.x, 0), y0 = fmax(damage.y, 0);
+    double x1 = fmin(damage.x + damage.w, width), y1 = fmin(damage.y + damage.h, height);
+
+    if (width > 0 && height > 0 && x1 > x0 && y1 > y0)
+    {
+        // 窗口坐标(原点在左上角)转换为帧缓冲坐标(原点在左下角)
+        double sx = (double)fbWidth / width, sy = (double)fbHeight / height;
+        GLint left = (GLint)floor(x0 * sx), right = (GLint)ceil(x1 * sx);
+        GLint bottom = (GLint)floor((height - y1) * sy), top = (GLint)ceil((height - y0) * sy);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, win->fbo);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(left, bottom, right - left, top - bottom);
+
+        // 清空颜色缓冲区
+        glClearColor(0.1f, 0.5f, 0.5f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        // 调用渲染回调函数
+        GUIhud *hud = win->hud;
+        guiFrameBegin(&win->frame);
+        if (hud)
+            guiHudGpuBegin(hud);
+        guiWindowDrawCallBack(win->listDraw, win);
+        if (hud)
+            guiHudGpuEnd(hud);
+        guiFrameEnd(&win->frame);
+
+        // 复制整个离屏帧缓冲, 裁剪测试也作用于复制, 需要先关闭
+        glDisable(GL_SCISSOR_TEST);
+        if (win->fbo)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, win->fbo);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, fbWidth, fbHeight, 0, 0, fbWidth, fbHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+
+        // 交换缓冲区
+        double start = hud ? glfwGetTime() : 0;
+        glfwSwapBuffers(win->window);
+        if (hud)
+        {
+            hud->frame[GUI_HUD_SWAP] += glfwGetTime() - start;
+            guiHudFrameEnd(hud);
+        }
+    }
 }
 
 void guiWindowStart(GUIwin *win)
@@ -280,55 +681,84 @@ void guiWindowStart(GUIwin *win)
     glfwSetCursorPosCallback(win->window, guiWindowCursorPosCallback);
     glfwSetCharModsCallback(win->window, guiWindowCharModsCallback);
     glfwSetScrollCallback(win->window, guiWindowScrollCallback);
+    glfwSetWindowRefreshCallback(win->window, guiWindowRefreshCallback);
 
-    // 帧率控制
-    GUIFrame *frame = guiFrameCreate(30);
-
+    bool busy = false; // 是否有未处理完的任务
     glfwShowWindow(win->window);
     while (!glfwWindowShouldClose(win->window))
     {
-        glfwWaitEvents();
-
-        // 处理任务
-        if (0 == sem_trywait(&win->semTask))
         {
-            pthread_mutex_lock(&win->mutexTask);
-            list *node = win->listTask.fd;
-            while (node != &win->listTask)
-            {
+            TRACE_ZONE("guiWindowWait");
 
-                node = node->fd;
-            }
-            pthread_mutex_unlock(&win->mutexTask);
+            // 没有需要重绘的区域时一直等待事件, 否则最多等到下一帧的截止时间
+            guiFrameWait(&win->frame, guiRectEmpty(&win->damage) == false, busy);
         }
+        TRACE_ZONE("guiWindowFrame");
 
-        // 渲染界面
-        if (guiFrameCheck(frame))
-        {
-            // 清空颜色缓冲区
-            glClearColor(0.1f, 0.5f, 0.5f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
+        // 分发这一帧缓冲的事件
+        GUIhud *hud = win->hud;
+        double start = hud ? glfwGetTime() : 0;
+        guiWindowDispatchEvents(win);
+        if (hud && win->hud == hud)
+            hud->frame[GUI_HUD_DISPATCH] += glfwGetTime() - start;
+
+        // 处理任务, 未处理完的任务在下一次循环继续处理
+        busy = guiWindowDoTask(win, GUI_TASK_TIME_BUDGET);
 
-            // 调用渲染回调函数
-            guiWindowDrawCallBack(win->listDraw, win);
+        // 只在有需要重绘的区域时渲染界面
+        bool animating = false;
+        if (guiFrameCheck(&win->frame, guiRectEmpty(&win->damage) == false))
+        {
+            guiWindowDraw(win);
 
-            // 交换缓冲区
-            glfwSwapBuffers(win->window);
+            // 绘制回调又标记了重绘区域, 说明有动画在进行
+            animating = guiRectEmpty(&win->damage) == false;
         }
+
+        // 动画或后台任务需要更多帧
+        if (animating || busy)
+            guiFrameRequest(&win->frame, GUI_FRAME_RATE_ACTIVE, glfwGetTime() + GUI_FRAME_ACTIVE_TIME);
     }
 
-    guiFrameDestroy(frame);
+    // 输出帧耗时统计
+    GUIframeStats stats;
+    guiFrameGetStats(&win->frame, &stats);
+    DEBUG("帧数: %llu, 错过截止时间: %llu, 帧耗时 p50: %.2fms, p99: %.2fms\n", (unsigned long long)stats.frames,
+          (unsigned long long)stats.missed, stats.p50 * 1000, stats.p99 * 1000);
 }
 
 void guiWindowQuit(GUIwin *win)
 {
-    // 释放所有控件
-    list *node = win->listWidget.fd;
-    while (node != &win->listWidget)
+    // 处理剩余的任务
+    guiWindowDoTask(win, 0);
+
+    // 释放所有控件, 每次移除都是O(1)
+    while (win->listWidget.count > 0)
     {
-        list *tmp = node;
-        node = node->fd;
-        GUIwidget *widget = (GUIwidget *)tmp->data;
+        list *node = win->listWidget.fd;
+        GUIwidget *widget = (GUIwidget *)node->data;
         guiWindowRemoveWidget(win, widget->id);
+
+        // ID对应的不是该控件时无法移除, 直接删除节点, 避免死循环
+        if (win->listWidget.fd == node)
+        {
+            widget->nodeWidget = NULL;
+            listDeleteNode(&win->listWidget, node, NULL);
+        }
+    }
+
+    // 释放离屏帧缓冲
+    if (win->fbo)
+    {
+        glDeleteFramebuffers(1, &win->fbo);
+        glDeleteRenderbuffers(1, &win->fboColor);
+        win->fbo = 0;
+        win->fboColor = 0;
     }
+
+    // 释放命中测试网格
+    guiHitQuit(&win->hit);
+    free(win->hitBuf);
+    win->hitBuf = NULL;
+    win->hitCap = 0;
 }
\ No newline at end of file
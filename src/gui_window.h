@@ -14,6 +14,11 @@
 #include <stb_truetype.h>
 
 #include "list.h"
+#include "ilist.h"
+#include "mpsc.h"
+
+#include "gui_frame.h"
+#include "gui_hittest.h"
 
 #include "gui.h"
 #include "gui_widget.h"
@@ -30,27 +35,38 @@
 #define GUI_CALL_PRIORITY_NUM 5
 #define GUI_CALL_PRIORITY_SAFE_GET(n) ((n) % GUI_CALL_PRIORITY_NUM)
 
-typedef struct _GUIwin
-{
-    GLFWwindow *window; // 窗口
+/**
+ * \brief 每帧处理任务的时间预算(秒), 超出的任务留到下一次循环
+ */
+#define GUI_TASK_TIME_BUDGET 0.004
 
-    // 任务
-    sem_t semTask;             // 任务信号量
-    list listTask;             // 任务列表
-    pthread_mutex_t mutexTask; // 任务锁
+/**
+ * \brief 事件环形缓冲区的容量, 必须是2的幂
+ */
+#define GUI_EVENT_RING 256
 
-    // 渲染列表
-    list listDraw[GUI_CALL_PRIORITY_NUM]; // 渲染任务列表
+/**
+ * \brief 帧率, 帧调度在错过截止时间时自动降低
+ */
+#define GUI_FRAME_RATE 60
 
-    // 事件列表
-    list listEventMouseButton[GUI_CALL_PRIORITY_NUM]; // 鼠标事件任务列表
-    list listEventCursorPos[GUI_CALL_PRIORITY_NUM];   // 光标事件任务列表
-    list listEventCharMods[GUI_CALL_PRIORITY_NUM];    // 字符事件任务列表
-    list listEventScroll[GUI_CALL_PRIORITY_NUM];      // 滚轮事件任务列表
+/**
+ * \brief 动画或后台任务进行时请求的帧率, 垂直同步时不会超过显示器的刷新率
+ */
+#define GUI_FRAME_RATE_ACTIVE 120
 
-    // 控件列表
-    list listWidget; // 控件列表
-} GUIwin;
+/**
+ * \brief 每次请求提高帧率的持续时间(秒), 动画或后台任务结束后回到GUI_FRAME_RATE
+ */
+#define GUI_FRAME_ACTIVE_TIME 0.25
+
+/**
+ * \brief 是否垂直同步
+ */
+#define GUI_FRAME_VSYNC true
+
+typedef struct _GUIwin GUIwin;
+typedef struct _GUIhud GUIhud;
 
 // 事件类型
 enum
@@ -69,9 +85,11 @@ typedef struct _GUIevent
     {
         struct // 鼠标事件
         {
-            int button; // 按键
-            int action; // 动作
-            int mods;   // 修饰键
+            int button;  // 按键
+            int action;  // 动作
+            int mods;    // 修饰键
+            double xpos; // 事件发生时的鼠标X坐标
+            double ypos; // 事件发生时的鼠标Y坐标
         } MouseButton;
         struct // 光标事件
         {
@@ -85,13 +103,77 @@ typedef struct _GUIevent
         } CharMods;
         struct // 滚轮事件
         {
-            double xoffset; // X轴偏移
-            double yoffset; // Y轴偏移
+            double xoffset; // X轴偏移(合并后为累计值)
+            double yoffset; // Y轴偏移(合并后为累计值)
         } Scroll;
     };
 
 } GUIevent;
 
+/**
+ * \brief 缓冲的事件
+ */
+typedef struct
+{
+    GUIevent event; // 事件
+    double x;       // 事件发生时的光标X坐标, 用于命中测试
+    double y;       // 事件发生时的光标Y坐标, 用于命中测试
+} GUIeventSlot;
+
+/**
+ * \brief 主线程任务, 由工作线程投递
+ */
+typedef struct _GUItask
+{
+    mpscNode node; // 队列节点
+
+    void (*fun)(GUIwin *win, void *arg); // 任务函数, 在主线程中调用
+    void *arg;                           // 任务参数
+} GUItask;
+
+typedef struct _GUIwin
+{
+    GLFWwindow *window; // 窗口
+
+    // 任务
+    mpsc queueTask; // 任务队列, 工作线程投递, 主线程处理
+
+    // 渲染列表, 链接嵌入在控件中(GUIwidget.linkDraw)
+    ilist listDraw[GUI_CALL_PRIORITY_NUM]; // 渲染任务列表
+
+    // 事件缓冲, GLFW回调只写入, 主循环每帧统一分发
+    GUIeventSlot ring[GUI_EVENT_RING]; // 事件环形缓冲区
+    uint32_t ringHead;                 // 下一个要分发的事件
+    uint32_t ringTail;                 // 下一个写入位置
+
+    // 事件列表, 链接嵌入在控件中(GUIwidget.linkEventXXX)
+    ilist listEventMouseButton[GUI_CALL_PRIORITY_NUM]; // 鼠标事件任务列表
+    ilist listEventCursorPos[GUI_CALL_PRIORITY_NUM];   // 光标事件任务列表
+    ilist listEventCharMods[GUI_CALL_PRIORITY_NUM];    // 字符事件任务列表
+    ilist listEventScroll[GUI_CALL_PRIORITY_NUM];      // 滚轮事件任务列表
+
+    // 命中测试, 有命中区域的控件不在上面的指针事件列表中, 而是登记在网格中
+    GUIhitGrid hit;     // 命中测试网格
+    uint64_t seq;       // 控件添加顺序的计数
+    GUIwidget **hitBuf; // 回调前复制的要调用的控件, 不够时扩大
+    int hitCap;         // hitBuf的容量
+
+    // 重绘区域, 没有需要重绘的区域时不渲染
+    GUIrect damage; // 下一帧需要重绘的区域, 为空表示不需要重绘
+    GUIFrame frame; // 帧调度
+
+    // 离屏帧缓冲, 保存完整的界面, 只重绘需要重绘的区域, 交换前整体复制到默认帧缓冲
+    GLuint fbo;              // 帧缓冲, 创建失败时为0, 每帧重绘整个窗口
+    GLuint fboColor;         // 颜色渲染缓冲
+    int fboWidth, fboHeight; // 帧缓冲大小(像素)
+
+    // 性能统计, 只在统计控件显示时不为NULL
+    GUIhud *hud;
+
+    // 控件列表
+    list listWidget; // 控件列表
+} GUIwin;
+
 /**
  * \brief 初始化窗口控制器
  * \param win 窗口控制器
@@ -112,6 +194,52 @@ void guiWindowAddWidget(GUIwin *win, uint64_t id);
  */
 void guiWindowRemoveWidget(GUIwin *win, uint64_t id);
 
+/**
+ * \brief 把控件加入指针事件的列表或命中测试网格(由命中区域决定)
+ * \param win 窗口控制器
+ * \param widget 控件
+ */
+void guiWindowAttachPointer(GUIwin *win, GUIwidget *widget);
+
+/**
+ * \brief 把控件从指针事件的列表和命中测试网格中移除
+ * \param win 窗口控制器
+ * \param widget 控件
+ */
+void guiWindowDetachPointer(GUIwin *win, GUIwidget *widget);
+
+/**
+ * \brief 标记需要重绘的区域, 只能在主线程调用(工作线程通过任务投递)
+ * \param win 窗口控制器
+ * \param rect 需要重绘的区域(窗口坐标), NULL表示整个窗口
+ */
+void guiWindowDamage(GUIwin *win, const GUIrect *rect);
+
+/**
+ * \brief 向窗口投递任务, 可在任意线程调用
+ * \param win 窗口控制器
+ * \param fun 任务函数, 在主线程中调用
+ * \param arg 任务参数
+ * \return 是否投递成功
+ */
+bool guiWindowPostTask(GUIwin *win, void (*fun)(GUIwin *win, void *arg), void *arg);
+
+/**
+ * \brief 处理任务队列, 只能在主线程调用
+ * \param win 窗口控制器
+ * \param budget 时间预算(秒), 小于等于0表示处理全部任务
+ * \return 是否还有未处理的任务
+ */
+bool guiWindowDoTask(GUIwin *win, double budget);
+
+/**
+ * \brief 分发缓冲的事件, 只能在主线程调用
+ *
+ * 只分发调用时已缓冲的事件, 回调中产生的新事件留到下一帧
+ * \param win 窗口控制器
+ */
+void guiWindowDispatchEvents(GUIwin *win);
+
 /**
  * \brief 启动窗口
  * \param win 窗口控制器
@@ -0,0 +1,108 @@
+/**
+ * \file ilist.h
+ * \brief 侵入式双向链表
+ *
+ * 链接嵌入在数据结构中, 添加和移除不分配内存, 遍历时不需要经过节点的data指针
+ *
+ * typedef struct { int value; ilist link; } item;
+ *
+ * ilist l;
+ * ilistInit(&l);
+ * ilistInit(&it->link);
+ * ilistAddTail(&l, &it->link);
+ *
+ * ILIST_FOR_EACH(node, &l)
+ * {
+ *     item *it = ILIST_CONTAINER(node, item, link);
+ *     ...
+ * }
+ *
+ * ilistRemove(&it->link); // O(1), 不需要知道所在的链表
+ */
+#ifndef ILIST_H
+#define ILIST_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define ILIST_CONTAINER(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+
+typedef struct _ilist ilist;
+typedef struct _ilist
+{
+    ilist *next; // 下一个
+    ilist *prev; // 上一个
+} ilist;
+
+/**
+ * \brief 初始化链表头或链接, 未链接时指向自身
+ * \param l 链表头或链接
+ */
+static inline void ilistInit(ilist *l)
+{
+    l->next = l->prev = l;
+}
+
+/**
+ * \brief 链表是否为空, 对链接则为是否未链接
+ * \param l 链表头或链接
+ */
+static inline bool ilistEmpty(const ilist *l)
+{
+    return l->next == l;
+}
+
+/**
+ * \brief 在pos之后插入链接
+ * \param pos 链表头或已链接的链接
+ * \param node 链接
+ */
+static inline void ilistInsertAfter(ilist *pos, ilist *node)
+{
+    node->prev = pos;
+    node->next = pos->next;
+    pos->next->prev = node;
+    pos->next = node;
+}
+
+/**
+ * \brief 添加到链表头部
+ * \param l 链表
+ * \param node 链接
+ */
+static inline void ilistAddHead(ilist *l, ilist *node)
+{
+    ilistInsertAfter(l, node);
+}
+
+/**
+ * \brief 添加到链表尾部
+ * \param l 链表
+ * \param node 链接
+ */
+static inline void ilistAddTail(ilist *l, ilist *node)
+{
+    ilistInsertAfter(l->prev, node);
+}
+
+/**
+ * \brief 从所在的链表中移除, 移除后链接重新初始化, 重复移除没有影响
+ * \param node 链接
+ */
+static inline void ilistRemove(ilist *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    ilistInit(node);
+}
+
+// 遍历链表, 遍历时不能移除当前节点
+#define ILIST_FOR_EACH(node, l) \
+    for (ilist *node = (l)->next; node != (l); node = node->next)
+
+// 遍历链表, 遍历时可以移除当前节点
+#define ILIST_FOR_EACH_SAFE(node, l)                                     \
+    for (ilist *node = (l)->next, *node##Next = node->next; node != (l); \
+         node = node##Next, node##Next = node->next)
+
+#endif // ILIST_H
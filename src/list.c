@@ -1,5 +1,10 @@
 #include "list.h"
 
+#include <pthread.h>
+
+#define LIST_SLAB_NODES 256   // 每次向系统申请的节点数量
+#define LIST_CACHE_MAX 1024   // 线程缓存的最大空闲节点数量, 超出时一半归还到全局池
+
 // 用于初始化list
 #define LIST_FD_BK_INIT(l)       \
     {                            \
@@ -21,6 +26,137 @@
         LIST_FD_BK_INIT(tmp);      \
     }
 
+/**
+ * \brief 线程的空闲节点缓存, 空闲节点用fd串成单链表
+ */
+typedef struct
+{
+    list *free; // 空闲节点
+    int count;  // 空闲节点数量
+} listCache;
+
+static _Thread_local listCache listLocal = {NULL, 0};           // 当前线程的缓存
+static pthread_mutex_t listPoolLock = PTHREAD_MUTEX_INITIALIZER; // 保护全局池
+static list *listPool = NULL;                                   // 全局池的空闲节点
+static pthread_once_t listOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t listKey;                                   // 线程结束时把缓存归还到全局池
+
+/**
+ * \brief 把一串空闲节点归还到全局池
+ * \param first 第一个节点
+ * \param last 最后一个节点
+ */
+static void listPoolPush(list *first, list *last)
+{
+    pthread_mutex_lock(&listPoolLock);
+    last->fd = listPool;
+    listPool = first;
+    pthread_mutex_unlock(&listPoolLock);
+}
+
+static void listCacheRelease(void *arg)
+{
+    (void)arg;
+    if (listLocal.free == NULL)
+        return;
+
+    list *last = listLocal.free;
+    while (last->fd)
+        last = last->fd;
+    listPoolPush(listLocal.free, last);
+    listLocal.free = NULL;
+    listLocal.count = 0;
+}
+
+static void listKeyInit(void)
+{
+    pthread_key_create(&listKey, listCacheRelease);
+}
+
+/**
+ * \brief 注册线程结束的回调, 值不为NULL时回调才会被调用, 缓存从空变为非空时调用
+ */
+static void listCacheRegister(void)
+{
+    pthread_once(&listOnce, listKeyInit);
+    pthread_setspecific(listKey, &listLocal);
+}
+
+/**
+ * \brief 线程缓存为空时, 从全局池取一批节点, 全局池也为空时申请一块新的节点
+ * \return 是否成功
+ */
+static bool listCacheFill(void)
+{
+    listCacheRegister();
+
+    pthread_mutex_lock(&listPoolLock);
+    if (listPool)
+    {
+        // 取出最多LIST_SLAB_NODES个节点
+        list *first = listPool;
+        list *last = first;
+        int count = 1;
+        while (count < LIST_SLAB_NODES && last->fd)
+        {
+            last = last->fd;
+            count++;
+        }
+        listPool = last->fd;
+        pthread_mutex_unlock(&listPoolLock);
+
+        last->fd = NULL;
+        listLocal.free = first;
+        listLocal.count = count;
+        return true;
+    }
+    pthread_mutex_unlock(&listPoolLock);
+
+    // 一块连续的节点, 不归还给系统, 节点在块中相邻
+    list *slab = (list *)malloc(sizeof(list) * LIST_SLAB_NODES);
+    if (slab == NULL)
+        return false;
+    for (int i = 0; i < LIST_SLAB_NODES - 1; i++)
+        slab[i].fd = &slab[i + 1];
+    slab[LIST_SLAB_NODES - 1].fd = NULL;
+    listLocal.free = slab;
+    listLocal.count = LIST_SLAB_NODES;
+    return true;
+}
+
+/**
+ * \brief 把一串节点放回线程缓存, 缓存过多时一半归还到全局池
+ * \param first 第一个节点
+ * \param last 最后一个节点
+ * \param count 节点数量
+ */
+static void listCachePush(list *first, list *last, int count)
+{
+    // 只释放节点的线程也要在结束时归还缓存
+    if (listLocal.free == NULL)
+        listCacheRegister();
+
+    last->fd = listLocal.free;
+    listLocal.free = first;
+    listLocal.count += count;
+
+    if (listLocal.count > LIST_CACHE_MAX)
+    {
+        int keep = LIST_CACHE_MAX / 2;
+        list *tail = listLocal.free;
+        for (int i = 1; i < keep; i++)
+            tail = tail->fd;
+
+        list *rest = tail->fd;
+        list *restLast = rest;
+        while (restLast->fd)
+            restLast = restLast->fd;
+        tail->fd = NULL;
+        listPoolPush(rest, restLast);
+        listLocal.count = keep;
+    }
+}
+
 void listInitList(list *l)
 {
     if (l == NULL)
@@ -33,10 +169,12 @@ list *listCreateNode()
 {
     list *node = NULL;
 
-    // 创建节点
-    node = (list *)malloc(sizeof(list));
-    if (node == NULL)
+    // 从线程缓存中取出节点
+    if (listLocal.free == NULL && listCacheFill() == false)
         return NULL;
+    node = listLocal.free;
+    listLocal.free = node->fd;
+    listLocal.count--;
 
     // 初始化节点
     LIST_NODE_INIT(node);
@@ -184,19 +322,29 @@ void listDeleteNode(list *l, list *node, void (*freeFun)(void *))
     }
 
     // 释放节点
-    free(node);
+    listCachePush(node, node, 1);
 
     return;
 }
 
 void listDeleteList(list *l, void (*freeFun)(void *))
 {
-    if (l == NULL)
+    if (l == NULL || l->fd == l)
         return;
 
-    // 释放所有节点
-    while (l->fd != l)
-        listDeleteNode(l, l->fd, freeFun);
+    // 释放所有节点的数据, 节点已经按fd串成链, 整条链一次放回缓存
+    list *first = l->fd;
+    list *last = l->bk;
+    int count = 0;
+    for (list *node = first; node != l; node = node->fd)
+    {
+        listDeleteNodeData(node, freeFun);
+        count++;
+    }
+    last->fd = NULL;
+    listCachePush(first, last, count);
+
+    LIST_NODE_INIT(l);
 
     return;
 }
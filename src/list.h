@@ -32,6 +32,7 @@ void listInitList(list *l);
 /**
  * \brief 创建一个节点
  * \return 新的节点
+ * \note 节点从按块申请的节点池中分配, 必须使用listDeleteNode或listDeleteList释放, 不能使用free
  */
 list *listCreateNode();
 
@@ -0,0 +1,729 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include "log.h"
+#include "trace.h"
+
+#include <time.h>
+#include <wchar.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define LOG_RING_SIZE 0x10000  // 每个线程的缓冲区大小, 必须是2的幂
+#define LOG_RECORD_MAX 0x800   // 单条记录的最大大小
+#define LOG_STR_MAX 0x200      // %s复制的最大长度
+#define LOG_SPEC_MAX 0x20      // 单个格式说明符的最大长度
+#define LOG_LINE_MAX 0x1000    // 格式化后单条日志的最大长度
+#define LOG_IDLE_MS 10         // 后台线程空闲时的等待时间
+#define LOG_LEVEL_PAD 0xFF     // 缓冲区末尾的填充记录
+
+/**
+ * \brief 记录头, 后面紧跟参数的二进制值
+ */
+typedef struct
+{
+    uint32_t size;   // 记录大小(含记录头, 按8字节对齐)
+    uint32_t level;  // 日志级别
+    uint64_t time;   // 时间戳(ns), 用于多线程间排序
+    const char *fmt; // 格式字符串
+} logRecord;
+
+/**
+ * \brief 线程的单生产者单消费者环形缓冲区
+ * \note 线程结束后留给之后的线程复用, 未输出的记录不会丢失
+ */
+typedef struct _logRing
+{
+    uint8_t data[LOG_RING_SIZE]; // 数据
+    _Atomic uint32_t head;       // 生产者写入的总字节数
+    _Atomic uint32_t tail;       // 消费者读取的总字节数
+    atomic_bool used;            // 是否属于某个线程
+    struct _logRing *next;       // 下一个缓冲区
+} logRing;
+
+static pthread_mutex_t logLock = PTHREAD_MUTEX_INITIALIZER; // 保护缓冲区链表
+static pthread_cond_t logWake = PTHREAD_COND_INITIALIZER;   // 唤醒后台线程
+static pthread_once_t logOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t logKey;                      // 线程结束时归还缓冲区
+static _Atomic(logRing *) logRings = NULL;         // 所有缓冲区
+static _Thread_local logRing *logLocal = NULL;     // 当前线程的缓冲区
+static atomic_bool logRunning = false;            // 后台线程是否在运行
+static atomic_int logWriters = 0;                 // 正在写入缓冲区的线程数
+static bool logStop = false;                      // 请求后台线程退出
+static pthread_t logThread;                       // 后台线程
+static atomic_uint logDropped = 0;                // 缓冲区满时丢弃的记录数
+
+/* 参数编码 */
+
+// 参数类型, 生产者和消费者用同样的方法解析格式字符串
+enum
+{
+    LOG_ARG_NONE,    // 没有参数(%%)
+    LOG_ARG_INT,     // 整数, 统一保存为long long
+    LOG_ARG_DOUBLE,  // double
+    LOG_ARG_LDOUBLE, // long double
+    LOG_ARG_PTR,     // 指针
+    LOG_ARG_STR,     // 字符串, 保存长度和内容
+    LOG_ARG_WSTR,    // 宽字符串
+    LOG_ARG_SKIP     // 不支持的参数(%n), 只消耗参数
+};
+
+// 长度修饰符
+enum
+{
+    LOG_LEN_NONE,
+    LOG_LEN_HH,
+    LOG_LEN_H,
+    LOG_LEN_L,
+    LOG_LEN_LL,
+    LOG_LEN_J,
+    LOG_LEN_Z,
+    LOG_LEN_T,
+    LOG_LEN_BIG_L
+};
+
+/**
+ * \brief 格式说明符
+ */
+typedef struct
+{
+    const char *start; // 说明符开始('%')
+    int len;           // 说明符长度
+    int stars;         // '*'宽度和精度的数量
+    int length;        // 长度修饰符
+    char conv;         // 转换字符
+    int type;          // 参数类型
+} logSpec;
+
+/**
+ * \brief 解析下一个格式说明符
+ * \param fmt 当前位置, 返回说明符之后的位置
+ * \param spec 说明符
+ * \return 说明符之前的普通字符数, 没有说明符时spec->start为NULL
+ */
+static size_t logNextSpec(const char **fmt, logSpec *spec)
+{
+    const char *s = *fmt;
+    const char *p = strchr(s, '%');
+    memset(spec, 0, sizeof(logSpec));
+    if (p == NULL)
+    {
+        *fmt = s + strlen(s);
+        return *fmt - s;
+    }
+
+    const char *q = p + 1;
+    while (*q && strchr("-+ #0'", *q))
+        q++;
+    if (*q == '*')
+        spec->stars++, q++;
+    while (*q >= '0' && *q <= '9')
+        q++;
+    if (*q == '.')
+    {
+        q++;
+        if (*q == '*')
+            spec->stars++, q++;
+        while (*q >= '0' && *q <= '9')
+            q++;
+    }
+
+    if (q[0] == 'h' && q[1] == 'h')
+        spec->length = LOG_LEN_HH, q += 2;
+    else if (q[0] == 'l' && q[1] == 'l')
+        spec->length = LOG_LEN_LL, q += 2;
+    else if (*q == 'h')
+        spec->length = LOG_LEN_H, q++;
+    else if (*q == 'l')
+        spec->length = LOG_LEN_L, q++;
+    else if (*q == 'j')
+        spec->length = LOG_LEN_J, q++;
+    else if (*q == 'z')
+        spec->length = LOG_LEN_Z, q++;
+    else if (*q == 't')
+        spec->length = LOG_LEN_T, q++;
+    else if (*q == 'L')
+        spec->length = LOG_LEN_BIG_L, q++;
+
+    spec->conv = *q;
+    switch (spec->conv)
+    {
+    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+        spec->type = LOG_ARG_INT;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        spec->type = spec->length == LOG_LEN_BIG_L ? LOG_ARG_LDOUBLE : LOG_ARG_DOUBLE;
+        break;
+    case 'p':
+        spec->type = LOG_ARG_PTR;
+        break;
+    case 's':
+        spec->type = spec->length == LOG_LEN_L ? LOG_ARG_WSTR : LOG_ARG_STR;
+        break;
+    case 'n':
+        spec->type = LOG_ARG_SKIP;
+        break;
+    default: // '%'或无效的说明符, 原样输出
+        spec->type = LOG_ARG_NONE;
+        break;
+    }
+    if (*q)
+        q++;
+
+    spec->start = p;
+    spec->len = (int)(q - p);
+    *fmt = q;
+    return p - s;
+}
+
+/**
+ * \brief 按长度修饰符取出整数参数
+ */
+static long long logArgInt(const logSpec *spec, va_list *ap)
+{
+    bool isSigned = spec->conv == 'd' || spec->conv == 'i';
+    switch (spec->length)
+    {
+    case LOG_LEN_L:
+        return isSigned ? (long long)va_arg(*ap, long) : (long long)va_arg(*ap, unsigned long);
+    case LOG_LEN_LL:
+        return isSigned ? va_arg(*ap, long long) : (long long)va_arg(*ap, unsigned long long);
+    case LOG_LEN_J:
+        return isSigned ? (long long)va_arg(*ap, intmax_t) : (long long)va_arg(*ap, uintmax_t);
+    case LOG_LEN_Z:
+        return (long long)va_arg(*ap, size_t);
+    case LOG_LEN_T:
+        return (long long)va_arg(*ap, ptrdiff_t);
+    default:
+        return isSigned ? (long long)va_arg(*ap, int) : (long long)va_arg(*ap, unsigned int);
+    }
+}
+
+#define LOG_ENCODE_FAIL ((size_t)-1) // 参数超出记录大小
+
+#define LOG_PUT(buf, pos, cap, value)                   \
+    do                                                  \
+    {                                                   \
+        if ((pos) + sizeof(value) > (cap))              \
+            return LOG_ENCODE_FAIL;                     \
+        memcpy((buf) + (pos), &(value), sizeof(value)); \
+        (pos) += sizeof(value);                         \
+    } while (0)
+
+/**
+ * \brief 把参数编码到buf中
+ * \return 编码后的大小, 超出cap时返回LOG_ENCODE_FAIL
+ */
+static size_t logEncode(uint8_t *buf, size_t cap, const char *fmt, va_list *ap)
+{
+    size_t pos = 0;
+    logSpec spec;
+    while (*fmt)
+    {
+        logNextSpec(&fmt, &spec);
+        if (spec.start == NULL)
+            break;
+
+        for (int i = 0; i < spec.stars; i++)
+        {
+            int star = va_arg(*ap, int);
+            LOG_PUT(buf, pos, cap, star);
+        }
+
+        switch (spec.type)
+        {
+        case LOG_ARG_INT:
+        {
+            long long v = logArgInt(&spec, ap);
+            LOG_PUT(buf, pos, cap, v);
+            break;
+        }
+        case LOG_ARG_DOUBLE:
+        {
+            double v = va_arg(*ap, double);
+            LOG_PUT(buf, pos, cap, v);
+            break;
+        }
+        case LOG_ARG_LDOUBLE:
+        {
+            long double v = va_arg(*ap, long double);
+            LOG_PUT(buf, pos, cap, v);
+            break;
+        }
+        case LOG_ARG_PTR:
+        {
+            void *v = va_arg(*ap, void *);
+            LOG_PUT(buf, pos, cap, v);
+            break;
+        }
+        case LOG_ARG_STR:
+        {
+            const char *v = va_arg(*ap, const char *);
+            if (v == NULL)
+                v = "(null)";
+            uint16_t len = (uint16_t)strnlen(v, LOG_STR_MAX);
+            LOG_PUT(buf, pos, cap, len);
+            if (pos + len > cap)
+                return LOG_ENCODE_FAIL;
+            memcpy(buf + pos, v, len);
+            pos += len;
+            break;
+        }
+        case LOG_ARG_WSTR:
+        {
+            const wchar_t *v = va_arg(*ap, const wchar_t *);
+            if (v == NULL)
+                v = L"(null)";
+            uint16_t len = 0;
+            while (len < LOG_STR_MAX && v[len])
+                len++;
+            LOG_PUT(buf, pos, cap, len);
+            if (pos + len * sizeof(wchar_t) > cap)
+                return LOG_ENCODE_FAIL;
+            memcpy(buf + pos, v, len * sizeof(wchar_t));
+            pos += len * sizeof(wchar_t);
+            break;
+        }
+        case LOG_ARG_SKIP:
+            (void)va_arg(*ap, void *);
+            break;
+        default:
+            break;
+        }
+    }
+    return pos;
+}
+
+#define LOG_GET(data, pos, value)                        \
+    do                                                   \
+    {                                                    \
+        memcpy(&(value), (data) + (pos), sizeof(value)); \
+        (pos) += sizeof(value);                          \
+    } while (0)
+
+// 用说明符格式化一个值, 处理'*'宽度和精度
+#define LOG_FORMAT(out, cap, spec, stars, star, value)                 \
+    ((stars) == 0   ? snprintf((out), (cap), (spec), (value))            \
+     : (stars) == 1 ? snprintf((out), (cap), (spec), (star)[0], (value)) \
+                    : snprintf((out), (cap), (spec), (star)[0], (star)[1], (value)))
+
+/**
+ * \brief 按格式字符串把记录格式化为文本
+ * \return 文本长度
+ */
+static size_t logDecode(char *out, size_t cap, const char *fmt, const uint8_t *data)
+{
+    size_t pos = 0, len = 0;
+    logSpec spec;
+    while (*fmt && len + 1 < cap)
+    {
+        const char *text = fmt;
+        size_t n = logNextSpec(&fmt, &spec);
+        if (n > cap - 1 - len)
+            n = cap - 1 - len;
+        memcpy(out + len, text, n);
+        len += n;
+        if (spec.start == NULL)
+            break;
+
+        char s[LOG_SPEC_MAX];
+        int sl = spec.len < LOG_SPEC_MAX ? spec.len : LOG_SPEC_MAX - 1;
+        memcpy(s, spec.start, sl);
+        s[sl] = '\0';
+
+        int star[2] = {0, 0};
+        for (int i = 0; i < spec.stars; i++)
+            LOG_GET(data, pos, star[i]);
+
+        int w = 0;
+        char *o = out + len;
+        size_t c = cap - len;
+        switch (spec.type)
+        {
+        case LOG_ARG_INT:
+        {
+            long long v;
+            LOG_GET(data, pos, v);
+            bool isSigned = spec.conv == 'd' || spec.conv == 'i';
+            switch (spec.length)
+            {
+            case LOG_LEN_L:
+                w = isSigned ? LOG_FORMAT(o, c, s, spec.stars, star, (long)v)
+                             : LOG_FORMAT(o, c, s, spec.stars, star, (unsigned long)v);
+                break;
+            case LOG_LEN_LL:
+                w = isSigned ? LOG_FORMAT(o, c, s, spec.stars, star, v)
+                             : LOG_FORMAT(o, c, s, spec.stars, star, (unsigned long long)v);
+                break;
+            case LOG_LEN_J:
+                w = isSigned ? LOG_FORMAT(o, c, s, spec.stars, star, (intmax_t)v)
+                             : LOG_FORMAT(o, c, s, spec.stars, star, (uintmax_t)v);
+                break;
+            case LOG_LEN_Z:
+                w = LOG_FORMAT(o, c, s, spec.stars, star, (size_t)v);
+                break;
+            case LOG_LEN_T:
+                w = LOG_FORMAT(o, c, s, spec.stars, star, (ptrdiff_t)v);
+                break;
+            default: // hh和h的参数也以int传递
+                w = isSigned ? LOG_FORMAT(o, c, s, spec.stars, star, (int)v)
+                             : LOG_FORMAT(o, c, s, spec.stars, star, (unsigned int)v);
+                break;
+            }
+            break;
+        }
+        case LOG_ARG_DOUBLE:
+        {
+            double v;
+            LOG_GET(data, pos, v);
+            w = LOG_FORMAT(o, c, s, spec.stars, star, v);
+            break;
+        }
+        case LOG_ARG_LDOUBLE:
+        {
+            long double v;
+            LOG_GET(data, pos, v);
+            w = LOG_FORMAT(o, c, s, spec.stars, star, v);
+            break;
+        }
+        case LOG_ARG_PTR:
+        {
+            void *v;
+            LOG_GET(data, pos, v);
+            w = LOG_FORMAT(o, c, s, spec.stars, star, v);
+            break;
+        }
+        case LOG_ARG_STR:
+        {
+            uint16_t n;
+            char str[LOG_STR_MAX + 1];
+            LOG_GET(data, pos, n);
+            memcpy(str, data + pos, n);
+            str[n] = '\0';
+            pos += n;
+            w = LOG_FORMAT(o, c, s, spec.stars, star, str);
+            break;
+        }
+        case LOG_ARG_WSTR:
+        {
+            uint16_t n;
+            wchar_t str[LOG_STR_MAX + 1];
+            LOG_GET(data, pos, n);
+            memcpy(str, data + pos, n * sizeof(wchar_t));
+            str[n] = L'\0';
+            pos += n * sizeof(wchar_t);
+            w = LOG_FORMAT(o, c, s, spec.stars, star, str);
+            break;
+        }
+        case LOG_ARG_SKIP:
+            break;
+        default: // %%和无效的说明符
+            w = spec.conv == '%' ? snprintf(o, c, "%%") : snprintf(o, c, "%s", s);
+            break;
+        }
+
+        if (w > 0)
+            len += (size_t)w < c ? (size_t)w : c - 1;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+/* 输出 */
+
+/**
+ * \brief 输出格式化好的一条日志
+ */
+static void logOutput(int level, const char *text)
+{
+    switch (level)
+    {
+    case LOG_LEVEL_ERROR:
+        fprintf(stderr, _BRED "%s" RESET, text);
+        break;
+    case LOG_LEVEL_SUCESS:
+        fprintf(stdout, _BGRN "%s" RESET, text);
+        break;
+    default:
+        fputs(text, stdout);
+        break;
+    }
+}
+
+/* 缓冲区 */
+
+static void logRingRelease(void *arg)
+{
+    logRing *ring = (logRing *)arg;
+    atomic_store_explicit(&ring->used, false, memory_order_release);
+}
+
+static void logKeyInit(void)
+{
+    pthread_key_create(&logKey, logRingRelease);
+}
+
+/**
+ * \brief 获取当前线程的缓冲区, 第一次调用时分配或复用空闲的缓冲区
+ */
+static logRing *logRingGet(void)
+{
+    if (logLocal)
+        return logLocal;
+
+    pthread_once(&logOnce, logKeyInit);
+    pthread_mutex_lock(&logLock);
+
+    // 只复用已经输出完的缓冲区, 结束的线程可能留下未输出的记录
+    logRing *ring = atomic_load_explicit(&logRings, memory_order_relaxed);
+    while (ring && (atomic_load_explicit(&ring->used, memory_order_acquire) ||
+                    atomic_load_explicit(&ring->tail, memory_order_acquire) !=
+                        atomic_load_explicit(&ring->head, memory_order_acquire)))
+        ring = ring->next;
+    if (ring == NULL)
+    {
+        ring = (logRing *)calloc(1, sizeof(logRing));
+        if (ring == NULL)
+        {
+            pthread_mutex_unlock(&logLock);
+            return NULL;
+        }
+        ring->next = atomic_load_explicit(&logRings, memory_order_relaxed);
+        atomic_store_explicit(&logRings, ring, memory_order_release);
+    }
+    atomic_store_explicit(&ring->used, true, memory_order_relaxed);
+
+    pthread_mutex_unlock(&logLock);
+
+    pthread_setspecific(logKey, ring);
+    logLocal = ring;
+    return ring;
+}
+
+/**
+ * \brief 写入记录, 空间不足时返回false
+ */
+static bool logRingPush(logRing *ring, const logRecord *rec, const uint8_t *args, size_t argSize)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t offset = head & (LOG_RING_SIZE - 1);
+    uint32_t need = rec->size;
+
+    // 记录不跨越缓冲区末尾, 剩余空间不够时用填充记录跳到开头
+    uint32_t pad = LOG_RING_SIZE - offset < need ? LOG_RING_SIZE - offset : 0;
+    if (LOG_RING_SIZE - (head - tail) < need + pad)
+        return false;
+
+    if (pad)
+    {
+        logRecord padRec = {pad, LOG_LEVEL_PAD, 0, NULL};
+        memcpy(ring->data + offset, &padRec, sizeof(uint32_t) * 2);
+        head += pad;
+        offset = 0;
+    }
+
+    memcpy(ring->data + offset, rec, sizeof(logRecord));
+    memcpy(ring->data + offset + sizeof(logRecord), args, argSize);
+    atomic_store_explicit(&ring->head, head + need, memory_order_release);
+
+    // 刚超过一半时提前唤醒后台线程, 减少突发日志被丢弃
+    if (head - tail < LOG_RING_SIZE / 2 && head + need - tail >= LOG_RING_SIZE / 2)
+        pthread_cond_signal(&logWake);
+    return true;
+}
+
+/**
+ * \brief 查看缓冲区中的下一条记录, 跳过填充记录
+ * \return 记录, 缓冲区为空时返回NULL
+ */
+static const logRecord *logRingPeek(logRing *ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    while (tail != head)
+    {
+        const logRecord *rec = (const logRecord *)(ring->data + (tail & (LOG_RING_SIZE - 1)));
+        if (rec->level != LOG_LEVEL_PAD)
+            return rec;
+        tail += rec->size;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    return NULL;
+}
+
+/**
+ * \brief 按时间顺序输出所有缓冲区中的记录
+ * \return 输出的记录数
+ */
+static int logDrain(void)
+{
+    char line[LOG_LINE_MAX];
+    int count = 0;
+
+    while (true)
+    {
+        // 找到时间最早的记录
+        logRing *best = NULL;
+        const logRecord *bestRec = NULL;
+        for (logRing *ring = atomic_load_explicit(&logRings, memory_order_acquire); ring; ring = ring->next)
+        {
+            const logRecord *rec = logRingPeek(ring);
+            if (rec && (bestRec == NULL || rec->time < bestRec->time))
+            {
+                best = ring;
+                bestRec = rec;
+            }
+        }
+        if (best == NULL)
+            break;
+
+        logDecode(line, sizeof(line), bestRec->fmt, (const uint8_t *)(bestRec + 1));
+        logOutput(bestRec->level, line);
+        atomic_fetch_add_explicit(&best->tail, bestRec->size, memory_order_release);
+        count++;
+    }
+
+    unsigned dropped = atomic_exchange_explicit(&logDropped, 0, memory_order_relaxed);
+    if (dropped)
+        fprintf(stderr, _BRED "日志缓冲区已满, 丢弃了 %u 条日志\n" RESET, dropped);
+
+    if (count || dropped)
+    {
+        fflush(stdout);
+        fflush(stderr);
+    }
+    return count;
+}
+
+/**
+ * \brief 后台输出线程
+ */
+static void *logThreadRun(void *arg)
+{
+    (void)arg;
+    TRACE_THREAD_NAME("log");
+
+    pthread_mutex_lock(&logLock);
+    while (logStop == false)
+    {
+        pthread_mutex_unlock(&logLock);
+        int count = logDrain();
+        pthread_mutex_lock(&logLock);
+
+        // 没有日志时等待一段时间, logQuit会立即唤醒
+        if (count == 0 && logStop == false)
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += LOG_IDLE_MS * 1000000L;
+            if (ts.tv_nsec >= 1000000000L)
+            {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&logWake, &logLock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&logLock);
+
+    logDrain();
+    return NULL;
+}
+
+int logInit(void)
+{
+    if (atomic_load(&logRunning))
+        return 1;
+
+    logStop = false;
+    if (pthread_create(&logThread, NULL, logThreadRun, NULL) != 0)
+        return 0;
+    atomic_store(&logRunning, true);
+    return 1;
+}
+
+void logQuit(void)
+{
+    if (atomic_load(&logRunning) == false)
+        return;
+
+    // 之后的日志同步输出, 等待已经通过检查的线程写完, 后台线程退出前会输出它们的记录
+    atomic_store(&logRunning, false);
+    while (atomic_load(&logWriters))
+        sched_yield();
+
+    pthread_mutex_lock(&logLock);
+    logStop = true;
+    pthread_cond_signal(&logWake);
+    pthread_mutex_unlock(&logLock);
+    pthread_join(logThread, NULL);
+}
+
+void logWrite(int level, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+
+    // 先登记再检查, 与logQuit先清除标志再等待配合, 不会在最后一次输出之后写入
+    atomic_fetch_add(&logWriters, 1);
+    logRing *ring = atomic_load(&logRunning) ? logRingGet() : NULL;
+    if (ring == NULL)
+    {
+        atomic_fetch_sub(&logWriters, 1);
+
+        // 后台线程未运行, 同步输出
+        char line[LOG_LINE_MAX];
+        vsnprintf(line, sizeof(line), fmt, ap);
+        logOutput(level, line);
+        va_end(ap);
+        return;
+    }
+
+    uint8_t args[LOG_RECORD_MAX - sizeof(logRecord)];
+    va_list copy;
+    va_copy(copy, ap);
+    size_t argSize = logEncode(args, sizeof(args), fmt, &copy);
+    va_end(copy);
+
+    if (argSize == LOG_ENCODE_FAIL)
+    {
+        // 参数太大, 退回为格式化好的文本(截断到LOG_STR_MAX)
+        char line[LOG_STR_MAX + 1];
+        int n = vsnprintf(line, sizeof(line), fmt, ap);
+        uint16_t len = n < 0 ? 0 : (n > LOG_STR_MAX ? LOG_STR_MAX : (uint16_t)n);
+        memcpy(args, &len, sizeof(len));
+        memcpy(args + sizeof(len), line, len);
+        argSize = sizeof(len) + len;
+        fmt = "%s";
+    }
+    va_end(ap);
+
+    logRecord rec;
+    rec.size = (uint32_t)((sizeof(logRecord) + argSize + 7) & ~(size_t)7);
+    rec.level = (uint32_t)level;
+    rec.time = traceNow();
+    rec.fmt = fmt;
+    if (logRingPush(ring, &rec, args, argSize) == false)
+    {
+        // 错误信息不能丢弃, 缓冲区满时直接输出
+        if (level == LOG_LEVEL_ERROR)
+        {
+            char line[LOG_LINE_MAX];
+            logDecode(line, sizeof(line), fmt, args);
+            logOutput(level, line);
+        }
+        else
+        {
+            atomic_fetch_add_explicit(&logDropped, 1, memory_order_relaxed);
+        }
+    }
+    atomic_fetch_sub_explicit(&logWriters, 1, memory_order_release);
+}
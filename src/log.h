@@ -1,12 +1,29 @@
 /**
  * @file log.h
  * @brief 调试相关的宏定义
+ *
+ * 日志分级输出, 低于LOG_LEVEL的日志在编译时去掉. logInit之后, ERROR/DEBUG/SUCESS只把格式字符串指针
+ * 和参数的二进制值写入当前线程的无锁环形缓冲区, 由后台线程格式化并输出, 调用线程不会阻塞在I/O上;
+ * 缓冲区满时丢弃日志. logInit之前和logQuit之后直接同步输出.
+ *
+ * 格式字符串必须是常量(后台线程格式化时才读取), %s的内容在写入时复制
  */
 #ifndef LOG_H
 #define LOG_H
 
 #include <stdio.h>
 
+// 日志级别
+#define LOG_LEVEL_DEBUG 0  // 调试信息
+#define LOG_LEVEL_SUCESS 1 // 成功信息
+#define LOG_LEVEL_ERROR 2  // 错误信息
+#define LOG_LEVEL_OFF 3    // 关闭日志
+
+// 编译时的日志级别, 低于该级别的日志不产生代码
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
 // 输出字体颜色
 #define RESET   "\x1B[0m"   // 重置为默认颜色
 #define _BLK    "\x1B[30m"  // 黑色
@@ -43,8 +60,44 @@
 #define BCYN(str)   "\x1B[96m" str RESET    // 亮青色
 #define BWHT(str)   "\x1B[97m" str RESET    // 亮白色
 
-#define ERROR(...) fprintf(stderr, _BRED __VA_ARGS__), fprintf(stderr, RESET);
-#define DEBUG(...) fprintf(stdout, __VA_ARGS__)
-#define SUCESS(...) fprintf(stdout, _BGRN __VA_ARGS__), fprintf(stdout, RESET);
+/**
+ * \brief 启动后台输出线程
+ * \return 是否成功, 失败时日志继续同步输出
+ */
+int logInit(void);
+
+/**
+ * \brief 输出所有缓冲的日志并停止后台线程
+ */
+void logQuit(void);
+
+/**
+ * \brief 写入一条日志
+ * \param level 日志级别
+ * \param fmt 格式字符串(常量)
+ */
+void logWrite(int level, const char *fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define ERROR(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define DEBUG(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_SUCESS
+#define SUCESS(...) logWrite(LOG_LEVEL_SUCESS, __VA_ARGS__)
+#else
+#define SUCESS(...) ((void)0)
+#endif
 
 #endif // LOG_H
\ No newline at end of file
@@ -7,6 +7,7 @@
 
 #include "rand.h"
 #include "RDH.h"
+#include "trace.h"
 
 #include <math.h>
 #include <string.h>
@@ -19,6 +20,12 @@ void Init()
     // 设置中文
     setlocale(LC_ALL, "zh_CN.UTF-8");
 
+    // 性能追踪
+    TRACE_THREAD_NAME("main");
+
+    // 启动日志线程
+    logInit();
+
     // 初始化glfw
     glfwInit();
     glfwGetError(NULL);
@@ -45,11 +52,17 @@ void Init()
 
 void Quit()
 {
+    /* 导出性能追踪 */
+    TRACE_DUMP(NULL);
+
     /* 释放资源 */
     resQuit();
 
     /* 释放glfw */
     glfwTerminate();
+
+    /* 输出剩余的日志 */
+    logQuit();
 }
 
 int main()
@@ -84,11 +97,21 @@ int main()
                   GUI_WIDGET_ID_MOUSEMOVE,
                   NULL, NULL, NULL, NULL,
                   &guiWidgetMouseMoveEvent, -1, GUI_CALL_PRIORITY_4, GUI_CALL_PRIORITY_4, -1, -1, NULL, NULL, NULL, NULL);
+
+    // 性能统计控件, 最后绘制, 默认隐藏
+    GUIwidget hud;
+    guiWidgetInit(&hud,
+                  0,
+                  GUI_WIDGET_ID_HUD,
+                  &guiWidgetHudInit, &guiWidgetHudDestroy, NULL,
+                  &guiWidgetHudDraw, &guiWidgetHudEvent, GUI_CALL_PRIORITY_4, -1, -1, GUI_CALL_PRIORITY_0, -1,
+                  NULL, NULL, NULL, NULL);
     
     // 创建窗口
     GUIwin win;
     guiWindowInit(&win, window);
     guiWindowAddWidget(&win, GUI_WIDGET_ID_MOUSEMOVE);
+    guiWindowAddWidget(&win, GUI_WIDGET_ID_HUD);
     guiWindowStart(&win);
     guiWindowQuit(&win);
 
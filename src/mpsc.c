@@ -0,0 +1,73 @@
+#include "mpsc.h"
+
+void mpscInit(mpsc *q)
+{
+    if (q == NULL)
+        return;
+
+    atomic_init(&q->stub.next, NULL);
+    atomic_init(&q->head, &q->stub);
+    q->tail = &q->stub;
+}
+
+void mpscPush(mpsc *q, mpscNode *node)
+{
+    if (q == NULL || node == NULL)
+        return;
+
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+
+    // 交换头节点, 再把前一个节点链接到新节点
+    mpscNode *prev = atomic_exchange_explicit(&q->head, node, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+mpscNode *mpscPop(mpsc *q)
+{
+    if (q == NULL)
+        return NULL;
+
+    mpscNode *tail = q->tail;
+    mpscNode *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    // 跳过哨兵节点
+    if (tail == &q->stub)
+    {
+        if (next == NULL)
+            return NULL;
+        q->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&next->next, memory_order_acquire);
+    }
+
+    if (next != NULL)
+    {
+        q->tail = next;
+        return tail;
+    }
+
+    // tail是最后一个节点时, 生产者可能正在入队
+    mpscNode *head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (tail != head)
+        return NULL;
+
+    // 重新放入哨兵节点, 使tail可以被取出
+    mpscPush(q, &q->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next != NULL)
+    {
+        q->tail = next;
+        return tail;
+    }
+
+    return NULL;
+}
+
+bool mpscEmpty(mpsc *q)
+{
+    if (q == NULL)
+        return true;
+
+    return q->tail == &q->stub &&
+           atomic_load_explicit(&q->stub.next, memory_order_acquire) == NULL;
+}
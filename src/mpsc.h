@@ -0,0 +1,64 @@
+/**
+ * \file mpsc.h
+ * \brief 无锁多生产者单消费者队列(侵入式)
+ *
+ * 节点嵌入在数据结构中, 入队不分配内存
+ *
+ * typedef struct { mpscNode node; int value; } item;
+ *
+ * // 任意线程入队
+ * mpscPush(&q, &it->node);
+ *
+ * // 只能在消费者线程出队
+ * mpscNode *node = mpscPop(&q);
+ * item *it = MPSC_CONTAINER(node, item, node);
+ */
+#ifndef MPSC_H
+#define MPSC_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#define MPSC_CONTAINER(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+
+typedef struct _mpscNode mpscNode;
+typedef struct _mpscNode
+{
+    _Atomic(mpscNode *) next; // 下一个节点
+} mpscNode;
+
+typedef struct
+{
+    _Atomic(mpscNode *) head; // 生产者入队位置
+    mpscNode *tail;           // 消费者出队位置
+    mpscNode stub;            // 哨兵节点
+} mpsc;
+
+/**
+ * \brief 初始化队列
+ * \param q 队列
+ */
+void mpscInit(mpsc *q);
+
+/**
+ * \brief 入队, 可在任意线程调用
+ * \param q 队列
+ * \param node 节点
+ */
+void mpscPush(mpsc *q, mpscNode *node);
+
+/**
+ * \brief 出队, 只能在消费者线程调用
+ * \param q 队列
+ * \return 节点, 若队列为空(或生产者尚未完成入队)则返回NULL
+ */
+mpscNode *mpscPop(mpsc *q);
+
+/**
+ * \brief 队列是否为空, 只能在消费者线程调用
+ * \param q 队列
+ */
+bool mpscEmpty(mpsc *q);
+
+#endif // MPSC_H
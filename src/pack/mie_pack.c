@@ -0,0 +1,275 @@
+/**
+ * \file mie_pack.c
+ * \brief 构建时把资源目录打包为一个资源包, 格式见resource_pack.h
+ *
+ * mie-pack <输出文件> <资源目录> <文件>...
+ *
+ * 文件名为相对于资源目录的路径, 分隔符统一为'/'.
+ * 压缩后不小于原大小的90%的文件(如jpeg)不压缩, 对齐到页后保存
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zlib.h"
+
+#include "../resource_pack.h"
+
+#define PACK_RATIO 90 // 压缩率(%)低于该值时才压缩
+
+// 按小端写入结构体的一个字段, 偏移和大小与结构体相同
+#define PACK_PUT(buf, type, field, value) \
+    packPut((buf) + offsetof(type, field), (value), sizeof(((type *)0)->field))
+
+typedef struct
+{
+    char *name;          // 文件名
+    uint8_t *data;       // 存储的数据
+    resPackEntry entry;  // 目录项
+} packFile;
+
+/**
+ * \brief 读取整个文件
+ */
+static uint8_t *packRead(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return NULL;
+
+    fseek(fp, 0L, SEEK_END);
+    long fileSize = ftell(fp);
+    fseek(fp, 0L, SEEK_SET);
+
+    uint8_t *data = fileSize >= 0 ? malloc((size_t)fileSize + 1) : NULL;
+    if (data && fread(data, 1, (size_t)fileSize, fp) != (size_t)fileSize)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+
+    *size = (size_t)fileSize;
+    return data;
+}
+
+/**
+ * \brief 得到相对于资源目录的文件名
+ */
+static char *packName(const char *dir, const char *path)
+{
+    size_t len = strlen(dir);
+    while (len > 0 && (dir[len - 1] == '/' || dir[len - 1] == '\\'))
+        len--;
+    if (strncmp(path, dir, len) == 0 && (path[len] == '/' || path[len] == '\\'))
+        path += len + 1;
+
+    char *name = malloc(strlen(path) + 1);
+    if (name == NULL)
+        return NULL;
+    for (size_t i = 0;; i++)
+    {
+        name[i] = path[i] == '\\' ? '/' : path[i];
+        if (path[i] == '\0')
+            break;
+    }
+    return name;
+}
+
+static int packCompare(const void *a, const void *b)
+{
+    return strcmp(((const packFile *)a)->name, ((const packFile *)b)->name);
+}
+
+/**
+ * \brief 按小端写入整数, 与主机字节序无关
+ */
+static void packPut(uint8_t *p, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        p[i] = (uint8_t)(value >> (8 * i));
+}
+
+/**
+ * \brief 写入文件头
+ */
+static bool packWriteHeader(FILE *fp, const resPackHeader *header)
+{
+    uint8_t buf[sizeof(resPackHeader)] = {0};
+    memcpy(buf + offsetof(resPackHeader, magic), header->magic, sizeof(header->magic));
+    PACK_PUT(buf, resPackHeader, version, header->version);
+    PACK_PUT(buf, resPackHeader, count, header->count);
+    PACK_PUT(buf, resPackHeader, namesOffset, header->namesOffset);
+    PACK_PUT(buf, resPackHeader, namesSize, header->namesSize);
+    return fwrite(buf, sizeof(buf), 1, fp) == 1;
+}
+
+/**
+ * \brief 写入目录项
+ */
+static bool packWriteEntry(FILE *fp, const resPackEntry *entry)
+{
+    uint8_t buf[sizeof(resPackEntry)] = {0};
+    PACK_PUT(buf, resPackEntry, offset, entry->offset);
+    PACK_PUT(buf, resPackEntry, size, entry->size);
+    PACK_PUT(buf, resPackEntry, rawSize, entry->rawSize);
+    PACK_PUT(buf, resPackEntry, name, entry->name);
+    PACK_PUT(buf, resPackEntry, nameLen, entry->nameLen);
+    PACK_PUT(buf, resPackEntry, method, entry->method);
+    return fwrite(buf, sizeof(buf), 1, fp) == 1;
+}
+
+/**
+ * \brief 写入0直到偏移对齐
+ */
+static bool packPad(FILE *fp, uint64_t *offset, uint64_t align)
+{
+    while (*offset % align)
+    {
+        if (fputc(0, fp) == EOF)
+            return false;
+        (*offset)++;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "用法: mie-pack <输出文件> <资源目录> <文件>...\n");
+        return 1;
+    }
+
+    int count = argc - 3;
+    packFile *files = calloc(count > 0 ? count : 1, sizeof(packFile));
+    if (files == NULL)
+        return 1;
+
+    // 读取并压缩
+    uint64_t namesSize = 0;
+    for (int i = 0; i < count; i++)
+    {
+        packFile *file = &files[i];
+        size_t size = 0;
+        uint8_t *raw = packRead(argv[i + 3], &size);
+        file->name = packName(argv[2], argv[i + 3]);
+        if (raw == NULL || file->name == NULL || strlen(file->name) > UINT16_MAX)
+        {
+            fprintf(stderr, "无法读取资源文件: %s\n", argv[i + 3]);
+            return 1;
+        }
+
+        file->entry.rawSize = size;
+        file->entry.nameLen = (uint16_t)strlen(file->name);
+        namesSize += file->entry.nameLen;
+
+        uLongf zsize = compressBound((uLong)size);
+        uint8_t *z = malloc(zsize);
+        if (z && compress2(z, &zsize, raw, (uLong)size, Z_BEST_COMPRESSION) == Z_OK &&
+            (uint64_t)zsize * 100 < (uint64_t)size * PACK_RATIO)
+        {
+            free(raw);
+            file->data = z;
+            file->entry.size = zsize;
+            file->entry.method = RES_PACK_ZLIB;
+        }
+        else
+        {
+            free(z);
+            file->data = raw;
+            file->entry.size = size;
+            file->entry.method = RES_PACK_STORED;
+        }
+    }
+
+    // 目录按文件名排序, 读取时二分查找
+    qsort(files, count, sizeof(packFile), packCompare);
+    for (int i = 1; i < count; i++)
+    {
+        if (strcmp(files[i - 1].name, files[i].name) == 0)
+        {
+            fprintf(stderr, "重复的资源文件: %s\n", files[i].name);
+            return 1;
+        }
+    }
+
+    // 计算布局: 压缩的数据紧密排列, 未压缩的数据对齐到页并在结尾补0
+    resPackHeader header = {RES_PACK_MAGIC, RES_PACK_VERSION, (uint32_t)count, 0, namesSize};
+    header.namesOffset = sizeof(resPackHeader) + (uint64_t)count * sizeof(resPackEntry);
+    uint64_t offset = header.namesOffset + namesSize;
+    uint32_t name = 0;
+    for (int i = 0; i < count; i++)
+    {
+        files[i].entry.name = name;
+        name += files[i].entry.nameLen;
+        if (files[i].entry.method == RES_PACK_ZLIB)
+        {
+            files[i].entry.offset = offset;
+            offset += files[i].entry.size;
+        }
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (files[i].entry.method != RES_PACK_STORED)
+            continue;
+        offset = (offset + RES_PACK_ALIGN - 1) / RES_PACK_ALIGN * RES_PACK_ALIGN;
+        files[i].entry.offset = offset;
+        offset += files[i].entry.size + 1;
+    }
+
+    // 写入
+    FILE *fp = fopen(argv[1], "wb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "无法创建资源包: %s\n", argv[1]);
+        return 1;
+    }
+
+    bool ok = packWriteHeader(fp, &header);
+    for (int i = 0; ok && i < count; i++)
+        ok = packWriteEntry(fp, &files[i].entry);
+    for (int i = 0; ok && i < count; i++)
+        ok = fwrite(files[i].name, 1, files[i].entry.nameLen, fp) == files[i].entry.nameLen;
+
+    offset = header.namesOffset + namesSize;
+    const int order[] = {RES_PACK_ZLIB, RES_PACK_STORED}; // 与计算布局时的顺序相同
+    for (int pass = 0; ok && pass < 2; pass++)
+    {
+        for (int i = 0; ok && i < count; i++)
+        {
+            packFile *file = &files[i];
+            if (file->entry.method != order[pass])
+                continue;
+            bool stored = file->entry.method == RES_PACK_STORED;
+            ok = packPad(fp, &offset, stored ? RES_PACK_ALIGN : 1) &&
+                 fwrite(file->data, 1, file->entry.size, fp) == file->entry.size;
+            offset += file->entry.size;
+            if (ok && stored)
+            {
+                ok = fputc(0, fp) != EOF;
+                offset++;
+            }
+        }
+    }
+
+    if (fclose(fp) != 0 || ok == false)
+    {
+        fprintf(stderr, "写入资源包失败: %s\n", argv[1]);
+        remove(argv[1]);
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        printf("%-48s %10llu -> %10llu%s\n", files[i].name, (unsigned long long)files[i].entry.rawSize,
+               (unsigned long long)files[i].entry.size, files[i].entry.method == RES_PACK_ZLIB ? " (zlib)" : "");
+        free(files[i].name);
+        free(files[i].data);
+    }
+    free(files);
+    return 0;
+}
@@ -1,113 +1,911 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
 #include "resource.h"
+#include "resource_pack.h"
+#include "res_embed.h"
+#include "trace.h"
+#include "zlib.h"
+
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define RES_INDEX_MIN 64        // 哈希表的初始容量, 必须是2的幂
+#define RES_NAME_BLOCK 0x1000   // 文件名字符串池每块的大小
+#define RES_MAP_MIN 0x10000     // 不小于该大小的文件使用内存映射
+#define RES_BUDGET_DEFAULT ((size_t)256 << 20) // 默认的内存预算
 
 typedef struct
 {
-    char *fileName;
+    const char *fileName; // 文件名(字符串池中的驻留字符串)
+    uint32_t hash;        // 文件名的哈希值
     void *data;
     size_t size;
+    uint8_t source;       // 数据的来源, 决定如何释放
+    bool live;            // 是否常驻内存
+    int refs;             // 引用计数
+    list *node;           // 在资源列表中的节点
+    list *lru;            // 在LRU列表中的节点, 只有没有引用的非常驻资源在LRU列表中
 } resItem;
 
+// 资源数据的来源
+enum
+{
+    RES_SOURCE_HEAP, // 堆
+    RES_SOURCE_MAP,  // 单独映射的文件
+    RES_SOURCE_PACK, // 资源包的映射中, 不需要释放
+    RES_SOURCE_EMBED, // 编译进程序的数组, 不需要释放
+};
+
+/**
+ * \brief 文件名字符串池的块, 只追加, 在resQuit时整体释放
+ */
+typedef struct _resNameBlock
+{
+    struct _resNameBlock *next; // 下一块
+    size_t used;                // 已使用的字节数
+    size_t cap;                 // 容量
+    char data[];                // 字符串
+} resNameBlock;
+
 char *resDir; // 资源目录
 list resList; // 资源列表
 
+static resItem **resIndex = NULL;        // 开放寻址(线性探测)的哈希表, 空槽为NULL
+static uint32_t resIndexCap = 0;         // 哈希表容量
+static uint32_t resIndexCount = 0;       // 已使用的槽数量
+static resNameBlock *resNames = NULL;    // 字符串池
+
+static uint8_t *resPack = NULL;          // 映射的资源包, 不存在时为NULL
+static size_t resPackSize = 0;           // 资源包大小
+
+// 资源列表, 哈希表, 字符串池, 引用计数, LRU列表和统计由resLock保护, 加载文件时不持有锁
+static pthread_mutex_t resLock = PTHREAD_MUTEX_INITIALIZER;
+
+static list resLru;                              // 可以淘汰的资源, 从头部(最久未使用)开始淘汰
+static resStats resStat = {.budget = RES_BUDGET_DEFAULT}; // 统计
+
+/**
+ * \brief 预加载的一组文件
+ */
+struct _resFuture
+{
+    int count;        // 文件数量
+    int pending;      // 未加载完的数量(由resQueueLock保护)
+    bool live;        // 是否常驻内存
+    char **names;     // 文件名
+    resItem **items;  // 加载的资源, 失败为NULL
+};
+
+/**
+ * \brief 加载队列中的一个文件
+ */
+typedef struct
+{
+    resFuture *future; // 所属的预加载
+    int index;         // 文件序号
+} resTask;
+
+static list resQueue;                                              // 加载队列
+static pthread_mutex_t resQueueLock = PTHREAD_MUTEX_INITIALIZER;   // 保护加载队列和pending
+static pthread_cond_t resQueueCond = PTHREAD_COND_INITIALIZER;     // 队列有新文件或有文件加载完
+static pthread_t resQueueThread;                                   // 加载线程
+static bool resQueueRunning = false;                               // 加载线程是否已启动
+static bool resQueueQuit = false;                                  // 加载线程退出标志
+
+/**
+ * \brief FNV-1a哈希
+ */
+static uint32_t resHash(const char *s)
+{
+    uint32_t hash = 2166136261u;
+    for (; *s; s++)
+        hash = (hash ^ (uint8_t)*s) * 16777619u;
+    return hash;
+}
+
+/**
+ * \brief 把文件名复制到字符串池中
+ * \return 驻留的字符串, 失败返回NULL
+ */
+static const char *resIntern(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    if (resNames == NULL || resNames->cap - resNames->used < len)
+    {
+        size_t cap = len > RES_NAME_BLOCK ? len : RES_NAME_BLOCK;
+        resNameBlock *block = malloc(sizeof(resNameBlock) + cap);
+        if (block == NULL)
+            return NULL;
+        block->next = resNames;
+        block->used = 0;
+        block->cap = cap;
+        resNames = block;
+    }
+
+    char *str = resNames->data + resNames->used;
+    memcpy(str, s, len);
+    resNames->used += len;
+    return str;
+}
+
+/**
+ * \brief 在哈希表中查找
+ * \return 资源, 不存在返回NULL
+ */
+static resItem *resIndexFind(const char *fileName, uint32_t hash)
+{
+    if (resIndexCount == 0)
+        return NULL;
+
+    uint32_t mask = resIndexCap - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        resItem *item = resIndex[i];
+        if (item == NULL)
+            return NULL;
+        if (item->hash == hash && strcmp(item->fileName, fileName) == 0)
+            return item;
+    }
+}
+
+/**
+ * \brief 插入哈希表(不检查重复), 负载超过70%时扩容
+ * \return 是否成功
+ */
+static bool resIndexInsert(resItem *item)
+{
+    if ((resIndexCount + 1) * 10 > resIndexCap * 7)
+    {
+        uint32_t cap = resIndexCap ? resIndexCap * 2 : RES_INDEX_MIN;
+        resItem **index = calloc(cap, sizeof(resItem *));
+        if (index == NULL)
+            return false;
+
+        // 重新插入所有的资源
+        for (uint32_t i = 0; i < resIndexCap; i++)
+        {
+            if (resIndex[i] == NULL)
+                continue;
+            uint32_t j = resIndex[i]->hash & (cap - 1);
+            while (index[j])
+                j = (j + 1) & (cap - 1);
+            index[j] = resIndex[i];
+        }
+
+        free(resIndex);
+        resIndex = index;
+        resIndexCap = cap;
+    }
+
+    uint32_t mask = resIndexCap - 1;
+    uint32_t i = item->hash & mask;
+    while (resIndex[i])
+        i = (i + 1) & mask;
+    resIndex[i] = item;
+    resIndexCount++;
+    return true;
+}
+
+/**
+ * \brief 从哈希表中删除, 把后面同一探测序列上的资源前移, 不需要墓碑
+ */
+static void resIndexRemove(resItem *item)
+{
+    uint32_t mask = resIndexCap - 1;
+    uint32_t i = item->hash & mask;
+    while (resIndex[i] != item)
+        i = (i + 1) & mask;
+
+    for (uint32_t j = (i + 1) & mask; resIndex[j]; j = (j + 1) & mask)
+    {
+        // 理想位置不在(i, j]之间的资源可以移动到i
+        uint32_t k = resIndex[j]->hash & mask;
+        if (((j - k) & mask) >= ((j - i) & mask))
+        {
+            resIndex[i] = resIndex[j];
+            i = j;
+        }
+    }
+    resIndex[i] = NULL;
+    resIndexCount--;
+}
+
+/**
+ * \brief 以只读方式映射整个文件
+ * \param path 路径
+ * \param size 返回文件大小
+ * \param loose 是否为单个资源文件, 此时小文件和大小是页大小的整数倍(映射后没有结尾的0)的文件不映射
+ * \return 映射的地址, 不映射或失败时返回NULL
+ */
+static void *resMapFile(const char *path, size_t *size, bool loose)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER fileSize;
+    void *addr = NULL;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 && (uint64_t)fileSize.QuadPart <= SIZE_MAX &&
+        (loose == false || (fileSize.QuadPart >= RES_MAP_MIN && fileSize.QuadPart % info.dwPageSize != 0)))
+    {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+        {
+            addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping); // 视图保持映射对象有效
+        }
+        *size = (size_t)fileSize.QuadPart;
+    }
+    CloseHandle(file);
+    return addr;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    void *addr = NULL;
+    long page = sysconf(_SC_PAGESIZE);
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && page > 0 &&
+        (loose == false || (st.st_size >= RES_MAP_MIN && st.st_size % page != 0)))
+    {
+        addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED)
+            addr = NULL;
+        *size = (size_t)st.st_size;
+    }
+    close(fd); // 映射保持文件有效
+    return addr;
+#endif
+}
+
+/**
+ * \brief 解除文件映射
+ */
+static void resUnmapFile(void *addr, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(addr);
+#else
+    munmap(addr, size);
+#endif
+}
+
+/**
+ * \brief 读取整个文件到堆中, 结尾补0
+ * \param path 路径
+ * \param size 返回文件大小
+ * \return 数据, 失败返回NULL
+ */
+static void *resReadFile(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return NULL;
+
+    // 获取文件大小
+    fseek(fp, 0L, SEEK_END);
+    long fileSize = ftell(fp);
+    fseek(fp, 0L, SEEK_SET);
+    if (fileSize < 0)
+    {
+        fclose(fp);
+        return NULL;
+    }
+
+    // 读取文件
+    char *fileData = malloc((size_t)fileSize + 1);
+    if (fileData)
+    {
+        fileSize = (long)fread(fileData, 1, (size_t)fileSize, fp);
+        fileData[fileSize] = '\0';
+        *size = (size_t)fileSize;
+    }
+
+    // 关闭文件
+    fclose(fp);
+    return fileData;
+}
+
+/**
+ * \brief 打开并检查资源包
+ * \param path 路径
+ */
+static void resPackOpen(const char *path)
+{
+    size_t size = 0;
+    uint8_t *pack = resMapFile(path, &size, false);
+    if (pack == NULL)
+        return;
+
+    // 检查文件头和目录的范围
+    const resPackHeader *header = (const resPackHeader *)pack;
+    if (size < sizeof(resPackHeader) || memcmp(header->magic, RES_PACK_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != RES_PACK_VERSION ||
+        (size - sizeof(resPackHeader)) / sizeof(resPackEntry) < header->count ||
+        header->namesOffset > size || header->namesSize > size - header->namesOffset)
+    {
+        ERROR("资源包 %s 格式错误\n", path);
+        resUnmapFile(pack, size);
+        return;
+    }
+
+    resPack = pack;
+    resPackSize = size;
+    DEBUG("资源包 %s : %u个文件\n", path, header->count);
+}
+
+/**
+ * \brief 在资源包中查找并读取文件
+ * \param fileName 文件名
+ * \param size 返回文件大小
+ * \param source 返回数据的来源
+ * \return 数据, 不存在或损坏时返回NULL
+ */
+static void *resPackLoad(const char *fileName, size_t *size, uint8_t *source)
+{
+    if (resPack == NULL)
+        return NULL;
+
+    // 按文件名二分查找目录
+    const resPackHeader *header = (const resPackHeader *)resPack;
+    const resPackEntry *toc = (const resPackEntry *)(resPack + sizeof(resPackHeader));
+    const char *names = (const char *)resPack + header->namesOffset;
+    size_t len = strlen(fileName);
+    const resPackEntry *entry = NULL;
+    uint32_t lo = 0, hi = header->count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const resPackEntry *e = &toc[mid];
+        if ((uint64_t)e->name + e->nameLen > header->namesSize)
+            return NULL;
+        int cmp = strncmp(fileName, names + e->name, e->nameLen);
+        if (cmp == 0)
+            cmp = len > e->nameLen ? 1 : (len < e->nameLen ? -1 : 0);
+        if (cmp == 0)
+        {
+            entry = e;
+            break;
+        }
+        if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    if (entry == NULL)
+        return NULL;
+
+    // 未压缩的数据直接指向映射, 结尾已经有0
+    if (entry->method == RES_PACK_STORED && entry->offset < resPackSize &&
+        entry->size < resPackSize - entry->offset && entry->size == entry->rawSize)
+    {
+        *size = (size_t)entry->size;
+        *source = RES_SOURCE_PACK;
+        return resPack + entry->offset;
+    }
+
+    // 压缩的数据解压到堆中
+    if (entry->method == RES_PACK_ZLIB && entry->offset <= resPackSize &&
+        entry->size <= resPackSize - entry->offset && entry->rawSize < SIZE_MAX)
+    {
+        uLongf rawSize = (uLongf)entry->rawSize;
+        uint8_t *data = malloc((size_t)entry->rawSize + 1);
+        if (data && uncompress(data, &rawSize, resPack + entry->offset, (uLong)entry->size) == Z_OK &&
+            rawSize == entry->rawSize)
+        {
+            data[rawSize] = '\0';
+            *size = (size_t)rawSize;
+            *source = RES_SOURCE_HEAP;
+            return data;
+        }
+        free(data);
+    }
+
+    ERROR("资源包中的文件 %s 已损坏\n", fileName);
+    return NULL;
+}
+
 void resDeleteItem(resItem *res)
 {
     if (res == NULL)
         return;
 
-    if (res->data)
+    if (res->refs > 0 && res->live == false)
+        DEBUG("资源文件 %s 释放时仍有%d个引用\n", res->fileName, res->refs);
+
+    if (res->source == RES_SOURCE_MAP)
+        resUnmapFile(res->data, res->size);
+    else if (res->source == RES_SOURCE_HEAP)
         free(res->data);
-    if (res->fileName)
-        free(res->fileName);
 
     free(res);
 }
 
+/**
+ * \brief 资源占用的内存, 资源包的映射和编译进程序的数组不计入
+ */
+static size_t resCost(const resItem *item)
+{
+    return item->source == RES_SOURCE_HEAP || item->source == RES_SOURCE_MAP ? item->size : 0;
+}
+
+/**
+ * \brief 把编译进程序的文件注册为常驻资源, 查找顺序因此为: 编译进程序的文件, 资源包, 资源目录
+ */
+static void resEmbedRegister(void)
+{
+    for (int i = 0; i < resEmbedCount; i++)
+    {
+        const resEmbedFile *file = &resEmbedFiles[i];
+        uint32_t hash = resHash(file->name);
+        if (resIndexFind(file->name, hash))
+            continue;
+
+        resItem *item = malloc(sizeof(resItem));
+        list *node = listCreateNode();
+        const char *name = resIntern(file->name);
+        if (item == NULL || node == NULL || name == NULL)
+        {
+            free(item);
+            listDeleteNode(NULL, node, NULL);
+            return;
+        }
+        item->fileName = name;
+        item->hash = hash;
+        item->data = (void *)file->data;
+        item->size = file->size;
+        item->source = RES_SOURCE_EMBED;
+        item->live = true;
+        item->refs = 0;
+        item->node = node;
+        item->lru = NULL;
+        if (resIndexInsert(item) == false)
+        {
+            free(item);
+            listDeleteNode(NULL, node, NULL);
+            return;
+        }
+        listAddNodeInStart(&resList, listDataToNode(node, item, 0, false));
+        resStat.count++;
+    }
+}
+
+/**
+ * \brief 资源被重新使用, 从LRU列表中移除(需要持有resLock)
+ */
+static void resTouch(resItem *item)
+{
+    if (item->lru)
+    {
+        listDeleteNode(&resLru, item->lru, NULL);
+        item->lru = NULL;
+    }
+}
+
+/**
+ * \brief 超出内存预算时淘汰最久未使用的资源(需要持有resLock)
+ * \param victims 被淘汰的资源, 由调用者在锁外释放
+ */
+static void resEvict(list *victims)
+{
+    while (resStat.bytes > resStat.budget && resLru.count > 0)
+    {
+        list *node = listGetNodeFromStart(&resLru);
+        resItem *item = (resItem *)node->data;
+        item->lru = NULL;
+
+        resIndexRemove(item);
+        listDeleteNode(&resList, item->node, NULL);
+        item->node = NULL;
+        resStat.bytes -= resCost(item);
+        resStat.count--;
+        resStat.evictions++;
+
+        // 复用LRU节点, 淘汰时不需要申请内存
+        listAddNodeInEnd(victims, node);
+    }
+}
+
 void resInit(const char *resourceDir)
 {
     // 初始化资源目录
     listInitList(&resList);
+    listInitList(&resQueue);
+    listInitList(&resLru);
 
     // 设置资源目录
     resDir = malloc(strlen(resourceDir) + 5);
     strcpy(resDir, resourceDir);
     if (resDir[strlen(resDir) - 1] != '\\')
         strcat(resDir, "\\");
+
+    // 打开资源包, 文件名为资源目录加扩展名
+    char path[256] = {0};
+    strncpy(path, resourceDir, sizeof(path) - sizeof(RES_PACK_SUFFIX));
+    size_t len = strlen(path);
+    while (len > 0 && (path[len - 1] == '\\' || path[len - 1] == '/'))
+        path[--len] = '\0';
+    strcat(path, RES_PACK_SUFFIX);
+    resPackOpen(path);
+
+    // 注册编译进程序的文件
+    pthread_mutex_lock(&resLock);
+    resEmbedRegister();
+    pthread_mutex_unlock(&resLock);
 }
 
-uint8_t *resGetFile(const char *fileName, uint8_t **data, size_t *size, bool live)
+/**
+ * \brief 获取资源并增加引用, 没有加载时加载(加载时不持有锁)
+ * \param fileName 资源文件名
+ * \param live 是否常驻内存
+ * \return 资源, 失败返回NULL
+ */
+static resItem *resAcquire(const char *fileName, bool live)
 {
-    if (fileName == NULL)
-        return false;
-
     // 检查文件是否存在资源列表中
-    list *node = resList.fd;
-    while (node != &resList)
+    uint32_t hash = resHash(fileName);
+    pthread_mutex_lock(&resLock);
+    resItem *item = resIndexFind(fileName, hash);
+    if (item)
     {
-        // 检查文件名
-        resItem *item = (resItem *)node->data;
-        if (strcmp(item->fileName, fileName) == 0)
-        {
-            // 如果已经加载，返回数据
-            if (data)
-                *data = item->data;
-            if (size)
-                *size = item->size;
-
-            // // 如果不常驻内存，删除节点
-            // if (live == false)
-            //     listDeleteNode(&resList, node, free); // 不删除数据，只删除节点
-            return item->data;
-        }
-        node = node->fd;
+        resTouch(item);
+        item->refs++;
+        resStat.hits++;
+        pthread_mutex_unlock(&resLock);
+        return item;
     }
+    pthread_mutex_unlock(&resLock);
 
-    // 如果没有加载，加载文件
-    char path[256] = {0};
-    strncpy(path, resDir, sizeof(path));
-    strncat(path, fileName, sizeof(path) - strlen(path) - 1);
+    // 如果没有加载，先从资源包中查找
+    TRACE_ZONE("resLoadFile");
+    size_t fileSize = 0;
+    uint8_t source = RES_SOURCE_PACK;
+    void *fileData = resPackLoad(fileName, &fileSize, &source);
 
-    FILE *fp = fopen(path, "rb");
-    if (fp == NULL)
+    // 再加载资源目录中的文件, 大文件映射到内存, 按需分页, 其余的读取到堆中
+    if (fileData == NULL)
+    {
+        char path[256] = {0};
+        strncpy(path, resDir, sizeof(path));
+        strncat(path, fileName, sizeof(path) - strlen(path) - 1);
+
+        source = RES_SOURCE_MAP;
+        fileData = resMapFile(path, &fileSize, true);
+        if (fileData == NULL)
+        {
+            source = RES_SOURCE_HEAP;
+            fileData = resReadFile(path, &fileSize);
+        }
+    }
+    if (fileData == NULL)
     {
         ERROR("资源文件 %s 不存在\n", fileName);
         return NULL;
     }
 
-    // 获取文件大小
-    fseek(fp, 0L, SEEK_END);
-    size_t fileSize = ftell(fp);
-    fseek(fp, 0L, SEEK_SET);
+    resItem *load = malloc(sizeof(resItem));
+    if (load)
+    {
+        load->hash = hash;
+        load->data = fileData;
+        load->size = fileSize;
+        load->source = source;
+        load->live = live;
+        load->refs = 1;
+        load->node = listCreateNode();
+        load->lru = NULL;
+    }
 
-    // 读取文件
-    char *fileData = malloc(fileSize + 1);
-    fread(fileData, 1, fileSize, fp);
-    fileData[fileSize] = '\0';
+    pthread_mutex_lock(&resLock);
 
-    // 关闭文件
-    fclose(fp);
+    // 加载期间其他线程可能已经加载了同一个文件
+    item = resIndexFind(fileName, hash);
+    if (item)
+    {
+        resTouch(item);
+        item->refs++;
+        resStat.hits++;
+        pthread_mutex_unlock(&resLock);
+        if (load)
+        {
+            listDeleteNode(NULL, load->node, NULL);
+            load->node = NULL;
+            load->refs = 0;
+            resDeleteItem(load);
+        }
+        return item;
+    }
+
+    // 添加到资源列表和哈希表
+    if (load && load->node && (load->fileName = resIntern(fileName)) && resIndexInsert(load))
+    {
+        listAddNodeInStart(&resList, listDataToNode(load->node, load, 0, false));
+        resStat.bytes += resCost(load);
+        resStat.count++;
+        resStat.misses++;
+
+        // 新资源有引用, 不会被淘汰
+        list victims;
+        listInitList(&victims);
+        resEvict(&victims);
+        pthread_mutex_unlock(&resLock);
+
+        listDeleteList(&victims, (void (*)(void *))resDeleteItem);
+        return load;
+    }
+    pthread_mutex_unlock(&resLock);
+
+    ERROR("资源文件 %s 无法加入缓存\n", fileName);
+    if (load)
+    {
+        listDeleteNode(NULL, load->node, NULL);
+        load->node = NULL;
+        load->refs = 0;
+        resDeleteItem(load);
+    }
+    return NULL;
+}
+
+uint8_t *resGetFile(const char *fileName, uint8_t **data, size_t *size, bool live)
+{
+    if (fileName == NULL)
+        return false;
+
+    resItem *item = resAcquire(fileName, live);
+    if (item == NULL)
+        return NULL;
 
-    // 拷贝数据
     if (data)
-        *data = fileData;
+        *data = item->data;
     if (size)
-        *size = fileSize;
+        *size = item->size;
+    return item->data;
+}
+
+void resRelease(const char *fileName)
+{
+    if (fileName == NULL)
+        return;
+
+    pthread_mutex_lock(&resLock);
+    resItem *item = resIndexFind(fileName, resHash(fileName));
 
-    // 如果常驻内存，添加到资源列表
-    if (live == true)
+    // 常驻的资源保留到resQuit
+    if (item == NULL || item->refs <= 0 || --item->refs > 0 || item->live)
     {
-        resItem *item = malloc(sizeof(resItem));
-        item->fileName = strdup(fileName);
-        item->data = fileData;
-        item->size = fileSize;
+        pthread_mutex_unlock(&resLock);
+        return;
+    }
+
+    // 没有引用的非常驻资源放到LRU列表尾部, 超出内存预算时淘汰
+    list victims;
+    listInitList(&victims);
+    item->lru = listCreateNode();
+    bool queued = item->lru != NULL;
+    if (queued)
+        listAddNodeInEnd(&resLru, listDataToNode(item->lru, item, 0, false));
+    resEvict(&victims);
+    pthread_mutex_unlock(&resLock);
+
+    // 不在LRU列表中的资源不会被淘汰, 保留到resQuit
+    if (queued == false)
+        ERROR("资源文件 %s 无法加入LRU列表, 内存不足\n", fileName);
+
+    // 在锁外解除映射或释放
+    listDeleteList(&victims, (void (*)(void *))resDeleteItem);
+}
+
+void resSetBudget(size_t budget)
+{
+    list victims;
+    listInitList(&victims);
+
+    pthread_mutex_lock(&resLock);
+    resStat.budget = budget;
+    resEvict(&victims);
+    pthread_mutex_unlock(&resLock);
+
+    listDeleteList(&victims, (void (*)(void *))resDeleteItem);
+}
+
+void resGetStats(resStats *stats)
+{
+    if (stats == NULL)
+        return;
+
+    pthread_mutex_lock(&resLock);
+    *stats = resStat;
+    pthread_mutex_unlock(&resLock);
+}
+
+/**
+ * \brief 后台加载线程, 依次加载队列中的文件
+ */
+static void *resPrefetchThread(void *arg)
+{
+    (void)arg;
+    TRACE_THREAD_NAME("res");
 
-        listAddNodeInStart(&resList, listDataToNode(listCreateNode(), item, 0, false));
+    pthread_mutex_lock(&resQueueLock);
+    while (true)
+    {
+        list *node = listGetNodeFromStart(&resQueue);
+        if (node == NULL)
+        {
+            if (resQueueQuit)
+                break;
+            pthread_cond_wait(&resQueueCond, &resQueueLock);
+            continue;
+        }
+        pthread_mutex_unlock(&resQueueLock);
+
+        // 加载一个文件
+        resTask *task = (resTask *)node->data;
+        resFuture *future = task->future;
+        future->items[task->index] = resAcquire(future->names[task->index], future->live);
+        listDeleteNode(NULL, node, free);
+
+        pthread_mutex_lock(&resQueueLock);
+        future->pending--;
+        pthread_cond_broadcast(&resQueueCond);
     }
-    
-    return fileData;
+    pthread_mutex_unlock(&resQueueLock);
+    return NULL;
+}
+
+resFuture *resPrefetch(const char *const *names, int count, bool live)
+{
+    if (names == NULL || count <= 0)
+        return NULL;
+
+    // 复制文件名, 调用者的数组不需要保持有效
+    size_t namesSize = 0;
+    for (int i = 0; i < count; i++)
+        namesSize += strlen(names[i]) + 1;
+    resFuture *future = calloc(1, sizeof(resFuture) + count * (sizeof(char *) + sizeof(resItem *)) + namesSize);
+    if (future == NULL)
+        return NULL;
+    future->count = count;
+    future->live = live;
+    future->names = (char **)(future + 1);
+    future->items = (resItem **)(future->names + count);
+    char *str = (char *)(future->items + count);
+    for (int i = 0; i < count; i++)
+    {
+        future->names[i] = str;
+        strcpy(str, names[i]);
+        str += strlen(names[i]) + 1;
+    }
+
+    pthread_mutex_lock(&resQueueLock);
+
+    // 第一次使用时启动加载线程
+    if (resQueueRunning == false)
+    {
+        if (pthread_create(&resQueueThread, NULL, resPrefetchThread, NULL) != 0)
+        {
+            pthread_mutex_unlock(&resQueueLock);
+            ERROR("资源加载线程创建失败\n");
+            free(future);
+            return NULL;
+        }
+        resQueueRunning = true;
+    }
+
+    // 加入队列, 按顺序加载
+    for (int i = 0; i < count; i++)
+    {
+        resTask *task = malloc(sizeof(resTask));
+        list *node = listCreateNode();
+        if (task == NULL || node == NULL)
+        {
+            free(task);
+            listDeleteNode(NULL, node, NULL);
+            continue;
+        }
+        task->future = future;
+        task->index = i;
+        listAddNodeInEnd(&resQueue, listDataToNode(node, task, 0, false));
+        future->pending++;
+    }
+    pthread_cond_signal(&resQueueCond);
+
+    pthread_mutex_unlock(&resQueueLock);
+    return future;
+}
+
+bool resFuturePoll(resFuture *future, int *loaded)
+{
+    if (future == NULL)
+        return true;
+
+    pthread_mutex_lock(&resQueueLock);
+    int pending = future->pending;
+    pthread_mutex_unlock(&resQueueLock);
+
+    if (loaded)
+        *loaded = future->count - pending;
+    return pending == 0;
+}
+
+bool resFutureWait(resFuture *future)
+{
+    if (future == NULL)
+        return false;
+
+    pthread_mutex_lock(&resQueueLock);
+    while (future->pending > 0)
+        pthread_cond_wait(&resQueueCond, &resQueueLock);
+    pthread_mutex_unlock(&resQueueLock);
+
+    for (int i = 0; i < future->count; i++)
+        if (future->items[i] == NULL)
+            return false;
+    return true;
+}
+
+void resFutureRelease(resFuture *future)
+{
+    if (future == NULL)
+        return;
+
+    // 等待加载结束后释放预加载持有的引用
+    resFutureWait(future);
+    for (int i = 0; i < future->count; i++)
+        if (future->items[i])
+            resRelease(future->names[i]);
+    free(future);
 }
 
 void resQuit(void)
 {
+    // 停止加载线程, 队列中剩余的文件仍会加载完
+    pthread_mutex_lock(&resQueueLock);
+    bool running = resQueueRunning;
+    resQueueQuit = true;
+    pthread_cond_broadcast(&resQueueCond);
+    pthread_mutex_unlock(&resQueueLock);
+    if (running)
+        pthread_join(resQueueThread, NULL);
+    resQueueRunning = false;
+    resQueueQuit = false;
+
+    listDeleteList(&resLru, NULL);
     listDeleteList(&resList, (void (*)(void *))resDeleteItem);
-}
\ No newline at end of file
+    resStat = (resStats){.budget = resStat.budget};
+
+    // 释放哈希表
+    free(resIndex);
+    resIndex = NULL;
+    resIndexCap = 0;
+    resIndexCount = 0;
+
+    // 释放字符串池
+    while (resNames)
+    {
+        resNameBlock *next = resNames->next;
+        free(resNames);
+        resNames = next;
+    }
+
+    // 关闭资源包
+    if (resPack)
+        resUnmapFile(resPack, resPackSize);
+    resPack = NULL;
+    resPackSize = 0;
+}
@@ -9,6 +9,17 @@
  * void *data = NULL;
  * size_t size = 0;
  * bool ret = resGetFile("test.txt", &data, &size, true);
+ *
+ * // 不常驻内存的资源用完后释放
+ * resGetFile("image.jpeg", &data, &size, false);
+ * resRelease("image.jpeg");
+ *
+ * // 在后台线程预加载, 之后resGetFile直接命中缓存
+ * const char *names[] = {"font.vert", "font.frag"};
+ * resFuture *future = resPrefetch(names, 2, true);
+ * while (resFuturePoll(future, NULL) == false)
+ *     ...
+ * resFutureRelease(future);
  * 
  * // 释放资源
  * resQuit();
@@ -37,10 +48,77 @@ void resInit(const char *resourceDir);
  * \param data 数据
  * \param size 大小
  * \param live 是否常驻内存(只有在第一次加载时有效)
- * \return 是否成功
+ * \return 数据, 失败返回NULL
+ * \note 数据是只读的(大文件直接映射到内存), 结尾保证有一个0, 不能由调用者释放;
+ *       每次调用增加一次引用, 非常驻的资源在引用全部释放后按LRU淘汰, 之后再使用时重新加载
  */
 uint8_t *resGetFile(const char *fileName, uint8_t **data, size_t *size, bool live);
 
+/**
+ * \brief 释放一次资源文件的引用
+ * \param fileName 资源文件名
+ */
+void resRelease(const char *fileName);
+
+/**
+ * \brief 资源缓存的统计
+ */
+typedef struct
+{
+    uint64_t hits;      // 命中次数
+    uint64_t misses;    // 未命中(加载)次数
+    uint64_t evictions; // 淘汰次数
+    size_t bytes;       // 缓存占用的内存(不包括资源包中未压缩的数据)
+    size_t budget;      // 内存预算
+    int count;          // 缓存的资源数量
+} resStats;
+
+/**
+ * \brief 设置内存预算, 超出时淘汰没有引用的非常驻资源
+ * \param budget 字节数, 默认256MB
+ * \note 常驻的资源和仍有引用的资源不会被淘汰, 此时占用可能超出预算
+ */
+void resSetBudget(size_t budget);
+
+/**
+ * \brief 获取资源缓存的统计
+ * \param stats 统计
+ */
+void resGetStats(resStats *stats);
+
+typedef struct _resFuture resFuture;
+
+/**
+ * \brief 在后台加载线程中按顺序预加载文件
+ * \param names 资源文件名(调用后不需要保持有效)
+ * \param count 文件数量
+ * \param live 是否常驻内存
+ * \return 预加载句柄, 失败返回NULL
+ * \note 预加载的资源持有一次引用, 直到resFutureRelease
+ */
+resFuture *resPrefetch(const char *const *names, int count, bool live);
+
+/**
+ * \brief 获取预加载进度
+ * \param future 预加载句柄
+ * \param loaded 已结束(包括失败)的文件数量, 可以为NULL
+ * \return 是否全部结束
+ */
+bool resFuturePoll(resFuture *future, int *loaded);
+
+/**
+ * \brief 等待预加载全部结束
+ * \param future 预加载句柄
+ * \return 是否全部加载成功
+ */
+bool resFutureWait(resFuture *future);
+
+/**
+ * \brief 等待预加载结束, 释放预加载持有的引用和句柄
+ * \param future 预加载句柄
+ */
+void resFutureRelease(resFuture *future);
+
 /**
  * \brief 删除资源列表
  */
@@ -0,0 +1,53 @@
+/**
+ * \file resource_pack.h
+ * \brief 资源包的文件格式, 由mie-pack在构建时生成, resource.c读取
+ *
+ * | 文件头 | 目录(按文件名排序) | 文件名 | 压缩的数据 | 对齐到页的未压缩数据 |
+ *
+ * 所有整数都是小端, mie-pack逐字节写入; resource.c直接映射结构体读取, 只支持小端的平台.
+ * 压缩的数据使用zlib, 读取时解压到堆中;
+ * 未压缩的数据起始地址对齐到RES_PACK_ALIGN, 后面有一个0, 映射后可以直接作为字符串使用
+ */
+#ifndef RESOURCE_PACK_H
+#define RESOURCE_PACK_H
+
+#include <stdint.h>
+
+#define RES_PACK_MAGIC "MIEPACK"  // 文件标识, 包括结尾的0共8字节
+#define RES_PACK_VERSION 1        // 格式版本
+#define RES_PACK_ALIGN 0x1000     // 未压缩数据的对齐
+#define RES_PACK_SUFFIX ".pak"    // 资源包的扩展名, 文件名为资源目录加扩展名
+
+// 数据的存储方式
+enum
+{
+    RES_PACK_STORED, // 未压缩
+    RES_PACK_ZLIB,   // zlib压缩
+};
+
+/**
+ * \brief 文件头
+ */
+typedef struct
+{
+    char magic[8];        // RES_PACK_MAGIC
+    uint32_t version;     // RES_PACK_VERSION
+    uint32_t count;       // 目录项数量, 目录紧跟在文件头之后
+    uint64_t namesOffset; // 文件名的偏移
+    uint64_t namesSize;   // 文件名的总大小
+} resPackHeader;
+
+/**
+ * \brief 目录项
+ */
+typedef struct
+{
+    uint64_t offset;  // 数据的偏移
+    uint64_t size;    // 存储的大小
+    uint64_t rawSize; // 原始大小
+    uint32_t name;    // 文件名相对于namesOffset的偏移, 文件名不以0结尾
+    uint16_t nameLen; // 文件名长度
+    uint16_t method;  // 存储方式
+} resPackEntry;
+
+#endif // RESOURCE_PACK_H
@@ -0,0 +1,396 @@
+/**
+ * \file rdh_bench.c
+ * \brief RDH 各阶段性能测试
+ *
+ * rdh_bench [-s 512,1024,...] [-t 1,2,4,...] [-w 预热次数] [-r 重复次数] [-j]
+ *
+ * 生成类似医学图像的合成灰度图(暗背景, 椭圆形组织, 内部结构和噪声), 分别测量
+ * shuffle/unshuffle/split/combine/embed/extract 的耗时, 输出MB/s, ns/pixel 和
+ * 每秒嵌入/提取的bit数. -t 指定的每个线程数会同时运行对应数量的独立图像, 报告总吞吐量.
+ * -j 输出JSON, 便于比较不同版本的结果
+ */
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "RDH.h"
+#include "rdh_pool.h"
+
+#define BENCH_LIST_MAX 16         // 尺寸和线程数列表的最大长度
+#define BENCH_KEY 0x2545F4914F6CDD1DULL // 洗牌密钥
+
+/**
+ * \brief 每个线程独立的测试数据
+ */
+typedef struct
+{
+    int w, h;             // 图像大小
+    uint8_t *img;         // 原图
+    uint8_t *work;        // 洗牌用的工作图像
+    uint8_t *share1;      // 份额1
+    uint8_t *share2;      // 份额2
+    uint8_t *embed1;      // 嵌入后的份额1
+    uint8_t *embed2;      // 嵌入后的份额2
+    uint8_t *out;         // 输出图像
+    uint8_t *payload;     // 载荷
+    int payloadSize;      // 载荷大小
+    uint8_t *m;           // 额外数据
+    int mSize;            // 额外数据大小
+    int bits;             // 本次处理的bit数
+    rdhStatus status;     // 本次的状态码
+} benchCtx;
+
+/**
+ * \brief 测试阶段
+ */
+typedef struct
+{
+    const char *name;               // 名称
+    void (*prepare)(benchCtx *ctx); // 准备数据, 不计时
+    void (*run)(benchCtx *ctx);     // 计时部分
+} benchStage;
+
+// 单次任务
+typedef struct
+{
+    benchCtx *ctx;
+    void (*fun)(benchCtx *ctx);
+} benchTask;
+
+static double benchNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * \brief 生成类似医学图像的合成灰度图
+ */
+static void benchGenImage(uint8_t *img, int w, int h, uint32_t seed)
+{
+    xSrand32(seed ? seed : 1);
+    double cx = w / 2.0, cy = h / 2.0;
+    double rx = w * 0.42, ry = h * 0.46;
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            double dx = (x - cx) / rx, dy = (y - cy) / ry;
+            double r = dx * dx + dy * dy;
+            int v = 8; // 背景
+            if (r < 1.0)
+            {
+                // 组织, 中心亮边缘暗
+                v = 70 + (int)(60 * (1.0 - r));
+
+                // 两个类似器官的内部结构
+                double ox = (x - cx * 0.7) / (rx * 0.25), oy = (y - cy) / (ry * 0.35);
+                double px = (x - cx * 1.3) / (rx * 0.25), py = (y - cy) / (ry * 0.35);
+                if (ox * ox + oy * oy < 1.0 || px * px + py * py < 1.0)
+                    v += 40;
+            }
+            v += (int)(xRand32() % 7) - 3; // 噪声
+            img[y * w + x] = (uint8_t)(v < 0 ? 0 : (v > 240 ? 240 : v));
+        }
+    }
+}
+
+static void benchCtxInit(benchCtx *ctx, int w, int h, uint32_t seed)
+{
+    size_t n = (size_t)w * h;
+    memset(ctx, 0, sizeof(benchCtx));
+    ctx->w = w;
+    ctx->h = h;
+    ctx->img = (uint8_t *)malloc(n);
+    ctx->work = (uint8_t *)malloc(n);
+    ctx->share1 = (uint8_t *)malloc(n);
+    ctx->share2 = (uint8_t *)malloc(n);
+    ctx->embed1 = (uint8_t *)malloc(n);
+    ctx->embed2 = (uint8_t *)malloc(n);
+    ctx->out = (uint8_t *)malloc(n);
+    benchGenImage(ctx->img, w, h, seed);
+
+    srand(seed);
+    rdhSplitImageTo(ctx->img, (int)n, ctx->share1, ctx->share2);
+
+    // 载荷约为每块1bit, 容量不足时减半
+    ctx->payloadSize = (w / 3) * (h / 3) / 8;
+    ctx->payload = (uint8_t *)malloc(ctx->payloadSize + 1);
+    for (int i = 0; i < ctx->payloadSize; i++)
+        ctx->payload[i] = (uint8_t)xRand32();
+    while (ctx->payloadSize > 0)
+    {
+        memcpy(ctx->embed1, ctx->share1, n);
+        memcpy(ctx->embed2, ctx->share2, n);
+        if (rdhEmbedData(ctx->embed1, ctx->embed2, w, h, &ctx->m, &ctx->mSize,
+                         ctx->payload, ctx->payloadSize) == RDH_SUCESS)
+            break;
+        ctx->payloadSize /= 2;
+    }
+}
+
+static void benchCtxFree(benchCtx *ctx)
+{
+    free(ctx->img);
+    free(ctx->work);
+    free(ctx->share1);
+    free(ctx->share2);
+    free(ctx->embed1);
+    free(ctx->embed2);
+    free(ctx->out);
+    free(ctx->payload);
+    rdhFree(ctx->m);
+}
+
+/* 各阶段 */
+
+static void benchPrepareShuffle(benchCtx *ctx)
+{
+    memcpy(ctx->work, ctx->img, (size_t)ctx->w * ctx->h);
+}
+static void benchRunShuffle(benchCtx *ctx)
+{
+    rdhShuffleImage(ctx->work, ctx->w * ctx->h, BENCH_KEY);
+}
+static void benchRunUnshuffle(benchCtx *ctx)
+{
+    rdhUnshuffleImage(ctx->work, ctx->w * ctx->h, BENCH_KEY);
+}
+static void benchRunSplit(benchCtx *ctx)
+{
+    rdhSplitImageTo(ctx->img, ctx->w * ctx->h, ctx->work, ctx->out);
+}
+static void benchRunCombine(benchCtx *ctx)
+{
+    rdhCombineImageTo(ctx->share1, ctx->share2, ctx->w * ctx->h, ctx->out);
+}
+static void benchPrepareEmbed(benchCtx *ctx)
+{
+    memcpy(ctx->work, ctx->share1, (size_t)ctx->w * ctx->h);
+    memcpy(ctx->out, ctx->share2, (size_t)ctx->w * ctx->h);
+}
+static void benchRunEmbed(benchCtx *ctx)
+{
+    uint8_t *m;
+    int mSize;
+    ctx->status = rdhEmbedData(ctx->work, ctx->out, ctx->w, ctx->h, &m, &mSize,
+                               ctx->payload, ctx->payloadSize);
+    ctx->bits = ctx->status == RDH_SUCESS ? ctx->payloadSize * 8 : 0;
+    if (ctx->status == RDH_SUCESS)
+        rdhFree(m);
+}
+static void benchPrepareExtract(benchCtx *ctx)
+{
+    memcpy(ctx->work, ctx->embed1, (size_t)ctx->w * ctx->h);
+    memcpy(ctx->out, ctx->embed2, (size_t)ctx->w * ctx->h);
+}
+static void benchRunExtract(benchCtx *ctx)
+{
+    uint8_t *data;
+    int size;
+    ctx->status = rdhExtractDataEx(ctx->work, ctx->out, ctx->w, ctx->h, ctx->m, ctx->mSize,
+                                   &data, &size, NULL, NULL);
+    ctx->bits = ctx->status == RDH_SUCESS ? ctx->payloadSize * 8 : 0;
+    if (ctx->status == RDH_SUCESS)
+        rdhFree(data);
+}
+
+static const benchStage benchStageList[] = {
+    {"shuffle", benchPrepareShuffle, benchRunShuffle},
+    {"unshuffle", benchPrepareShuffle, benchRunUnshuffle},
+    {"split", NULL, benchRunSplit},
+    {"combine", NULL, benchRunCombine},
+    {"embed", benchPrepareEmbed, benchRunEmbed},
+    {"extract", benchPrepareExtract, benchRunExtract},
+};
+#define BENCH_STAGE_NUM (sizeof(benchStageList) / sizeof(benchStageList[0]))
+
+static void benchTaskRun(int worker, void *arg)
+{
+    (void)worker;
+    benchTask *task = (benchTask *)arg;
+    task->fun(task->ctx);
+}
+
+/**
+ * \brief 在threads个线程上同时执行fun
+ */
+static void benchParallel(rdhPool *pool, benchCtx *ctx, int threads, void (*fun)(benchCtx *ctx))
+{
+    if (threads == 1)
+    {
+        fun(ctx);
+        return;
+    }
+
+    benchTask tasks[BENCH_LIST_MAX * 64];
+    for (int i = 0; i < threads; i++)
+    {
+        tasks[i].ctx = &ctx[i];
+        tasks[i].fun = fun;
+        rdhPoolSubmit(pool, benchTaskRun, &tasks[i]);
+    }
+    rdhPoolWait(pool);
+}
+
+static int benchCompare(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * \brief 解析逗号分隔的整数列表
+ */
+static int benchParseList(const char *s, int *list)
+{
+    int count = 0;
+    while (*s && count < BENCH_LIST_MAX)
+    {
+        char *end;
+        long v = strtol(s, &end, 10);
+        if (end == s)
+            break;
+        if (v > 0)
+            list[count++] = (int)v;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+static void benchUsage(void)
+{
+    fprintf(stderr, "用法: rdh_bench [-s 512,1024,...,16384] [-t 1,2,4,...] [-w 预热次数] [-r 重复次数] [-j]\n");
+}
+
+int main(int argc, char **argv)
+{
+    int sizes[BENCH_LIST_MAX] = {512, 1024, 2048, 4096};
+    int sizeCount = 4;
+    int threadList[BENCH_LIST_MAX] = {1};
+    int threadCount = 1;
+    int warmup = 1;
+    int reps = 5;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            sizeCount = benchParseList(argv[++i], sizes);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            threadCount = benchParseList(argv[++i], threadList);
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-j") == 0)
+            json = true;
+        else
+        {
+            benchUsage();
+            return 1;
+        }
+    }
+    if (sizeCount == 0 || threadCount == 0 || reps <= 0 || warmup < 0)
+    {
+        benchUsage();
+        return 1;
+    }
+
+    int maxThreads = 1;
+    for (int i = 0; i < threadCount; i++)
+    {
+        if (threadList[i] > BENCH_LIST_MAX * 64)
+            threadList[i] = BENCH_LIST_MAX * 64;
+        if (threadList[i] > maxThreads)
+            maxThreads = threadList[i];
+    }
+    rdhPool *pool = maxThreads > 1 ? rdhPoolCreate(maxThreads) : NULL;
+    double *times = (double *)malloc(sizeof(double) * reps);
+
+    if (json)
+        printf("{\n  \"warmup\": %d,\n  \"reps\": %d,\n  \"results\": [", warmup, reps);
+    else
+        printf("%-10s %7s %4s %12s %12s %10s %10s %12s\n",
+               "stage", "size", "thr", "median(ms)", "min(ms)", "MB/s", "ns/pixel", "Mbit/s");
+
+    bool first = true;
+    for (int s = 0; s < sizeCount; s++)
+    {
+        int w = sizes[s], h = sizes[s];
+        double pixels = (double)w * h;
+
+        for (int t = 0; t < threadCount; t++)
+        {
+            int threads = threadList[t];
+            benchCtx *ctx = (benchCtx *)malloc(sizeof(benchCtx) * threads);
+            for (int i = 0; i < threads; i++)
+                benchCtxInit(&ctx[i], w, h, (uint32_t)(s * 1000 + i + 1));
+
+            for (size_t k = 0; k < BENCH_STAGE_NUM; k++)
+            {
+                const benchStage *stage = &benchStageList[k];
+                int bits = 0;
+
+                for (int r = -warmup; r < reps; r++)
+                {
+                    if (stage->prepare)
+                        benchParallel(pool, ctx, threads, stage->prepare);
+
+                    double start = benchNow();
+                    benchParallel(pool, ctx, threads, stage->run);
+                    double end = benchNow();
+
+                    if (r >= 0)
+                        times[r] = end - start;
+                    bits = 0;
+                    for (int i = 0; i < threads; i++)
+                        bits += ctx[i].bits;
+                }
+
+                qsort(times, reps, sizeof(double), benchCompare);
+                double median = times[reps / 2];
+                double best = times[0];
+                double total = pixels * threads;             // 所有线程处理的像素数
+                double mbs = total / median / (1024 * 1024); // 每个像素1字节
+                double nsPixel = median * 1e9 / total;
+                double bitsPerSec = bits / median;
+
+                if (json)
+                {
+                    printf("%s\n    {\"stage\": \"%s\", \"width\": %d, \"height\": %d, \"threads\": %d, "
+                           "\"median_ns\": %.0f, \"min_ns\": %.0f, \"mb_per_s\": %.2f, "
+                           "\"ns_per_pixel\": %.4f, \"bits\": %d, \"bits_per_s\": %.0f}",
+                           first ? "" : ",", stage->name, w, h, threads,
+                           median * 1e9, best * 1e9, mbs, nsPixel, bits, bitsPerSec);
+                    first = false;
+                }
+                else
+                {
+                    printf("%-10s %7d %4d %12.3f %12.3f %10.1f %10.3f %12.3f\n",
+                           stage->name, w, threads, median * 1e3, best * 1e3, mbs, nsPixel,
+                           bitsPerSec / 1e6);
+                }
+                fflush(stdout);
+            }
+
+            for (int i = 0; i < threads; i++)
+                benchCtxFree(&ctx[i]);
+            free(ctx);
+        }
+    }
+
+    if (json)
+        printf("\n  ]\n}\n");
+
+    free(times);
+    rdhPoolDestroy(pool);
+    return 0;
+}
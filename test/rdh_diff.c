@@ -0,0 +1,768 @@
+/**
+ * \file rdh_diff.c
+ * \brief RDH 差分测试
+ *
+ * 用本文件中逐像素的标量参考实现, 检查库中每个变体(分配/写入缓冲区版本, 带进度回调的Ex版本,
+ * 异步任务, 自定义分配器, 线程池工作线程)的结果是否逐位一致, 并检查嵌入提取的往返恢复.
+ * 新增的快速实现(SIMD, 并行, 融合等)需要加入对应的变体表. 失败时返回非0, 由ctest运行
+ *
+ * rdh_diff [轮数] [随机数种子]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "RDH.h"
+#include "rdh_job.h"
+#include "rdh_pool.h"
+
+#define DIFF_ROUNDS 40 // 默认轮数
+#define DIFF_SEED 1234 // 默认种子
+
+static int diffChecks = 0;   // 检查次数
+static int diffFailures = 0; // 失败次数
+
+#define DIFF_CHECK(cond, ...)                                \
+    do                                                       \
+    {                                                        \
+        diffChecks++;                                        \
+        if (!(cond))                                         \
+        {                                                    \
+            diffFailures++;                                  \
+            fprintf(stderr, "[%s:%d] ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                    \
+            fprintf(stderr, "\n");                           \
+        }                                                    \
+    } while (0)
+
+/* ---------------------------------------------------------------------------
+ * 标量参考实现
+ *
+ * 按照算法描述逐像素实现, 不追求速度, 不与库共享代码(洗牌和分割必须使用同样的随机数序列)
+ * 块内像素按行排列:
+ *     SP1 EP1 SP2
+ *     EP2 EP3 EP4
+ *     SP3 EP5 SP4
+ * ------------------------------------------------------------------------- */
+
+static const int refEP[5] = {1, 3, 4, 5, 7};                                    // EP在块内的位置
+static const int refSP[4] = {0, 2, 6, 8};                                       // SP在块内的位置
+static const int refEPNear[5][4] = {{0, 2}, {0, 6}, {0, 2, 6, 8}, {2, 8}, {6, 8}}; // 预测EP使用的SP
+static const int refEPNearCount[5] = {2, 2, 4, 2, 2};
+static const int refSDPair[4][2] = {{0, 1}, {2, 5}, {6, 7}, {8, 3}}; // sdHSB使用的(SP, EP)
+
+#define RDH_OVERFLOW_MIN (0xFF - 0x08 + 1) // 份额1中会导致块被跳过的最小像素值
+
+static int refFloorDiv(int a, int n)
+{
+    return a >= 0 ? a / n : -((-a + n - 1) / n);
+}
+
+// 出现次数最多的值, 次数相同取较大值
+static int refPeak(const int *v, int count)
+{
+    int best = v[0], bestCount = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int c = 0;
+        for (int k = 0; k < count; k++)
+            c += v[k] == v[i];
+        if (c > bestCount || (c == bestCount && v[i] > best))
+        {
+            best = v[i];
+            bestCount = c;
+        }
+    }
+    return best;
+}
+
+static void refDHSB(const int *b1, const int *b2, int *d)
+{
+    for (int k = 0; k < 5; k++)
+    {
+        int n = refEPNearCount[k];
+        int sum = n * (b1[refEP[k]] >> 3) + n * (b2[refEP[k]] >> 3);
+        for (int s = 0; s < n; s++)
+            sum -= (b1[refEPNear[k][s]] >> 3) + (b2[refEPNear[k][s]] >> 3);
+        d[k] = refFloorDiv(sum, n);
+    }
+}
+
+static void refSDHSB(const int *b1, const int *b2, int *sd)
+{
+    for (int k = 0; k < 4; k++)
+    {
+        int sp = refSDPair[k][0], ep = refSDPair[k][1];
+        sd[k] = ((b1[sp] >> 3) - (b1[ep] >> 3)) + ((b2[sp] >> 3) - (b2[ep] >> 3));
+    }
+}
+
+static int refGetBit(const uint8_t *data, int total, int *now)
+{
+    if (*now >= total)
+        return 0;
+    int bit = (data[*now >> 3] >> (*now & 7)) & 1;
+    *now += 1;
+    return bit;
+}
+
+static void refBlockLoad(const uint8_t *img, int w, int x, int y, int *b)
+{
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            b[r * 3 + c] = img[(y + r) * w + x + c];
+}
+
+static void refBlockStore(uint8_t *img, int w, int x, int y, const int *b)
+{
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            img[(y + r) * w + x + c] = (uint8_t)b[r * 3 + c];
+}
+
+static uint8_t refEmbedBlock(int *b1, const int *b2, const uint8_t *data, int total, int *now)
+{
+    for (int k = 0; k < 9; k++)
+        if (b1[k] >= RDH_OVERFLOW_MIN)
+            return 0;
+
+    int m = 1;
+    int d[5], sd[4];
+
+    refDHSB(b1, b2, d);
+    int me1 = refPeak(d, 5);
+    bool first = true;
+    for (int k = 0; k < 5; k++)
+    {
+        if (d[k] == me1)
+        {
+            int bit = refGetBit(data, total, now);
+            b1[refEP[k]] += 8 * bit;
+            if (first)
+                m |= k << 5 | bit << 4;
+            first = false;
+        }
+        else if (d[k] > me1)
+            b1[refEP[k]] += 8;
+    }
+
+    refSDHSB(b1, b2, sd);
+    int me2 = refPeak(sd, 4);
+    first = true;
+    for (int k = 0; k < 4; k++)
+    {
+        if (sd[k] == me2)
+        {
+            int bit = refGetBit(data, total, now);
+            b1[refSP[k]] += 8 * bit;
+            if (first)
+                m |= k << 2 | bit << 1;
+            first = false;
+        }
+        else if (sd[k] > me2)
+            b1[refSP[k]] += 8;
+    }
+
+    return (uint8_t)m;
+}
+
+static void refExtractBlock(int *b1, const int *b2, uint8_t *data, int *now, uint8_t m)
+{
+    if ((m & 1) == 0)
+        return;
+
+    int d[5], sd[4];
+    int bits[9], count = 0;
+
+    refSDHSB(b1, b2, sd);
+    int me2 = sd[(m >> 2) & 3] - ((m >> 1) & 1);
+    int spBits[4], spCount = 0;
+    for (int k = 0; k < 4; k++)
+    {
+        if (sd[k] == me2 || sd[k] == me2 + 1)
+            spBits[spCount++] = sd[k] - me2;
+        if (sd[k] > me2)
+            b1[refSP[k]] -= 8;
+    }
+
+    refDHSB(b1, b2, d);
+    int me1 = d[(m >> 5) & 7] - ((m >> 4) & 1);
+    for (int k = 0; k < 5; k++)
+    {
+        if (d[k] == me1 || d[k] == me1 + 1)
+            bits[count++] = d[k] - me1;
+        if (d[k] > me1)
+            b1[refEP[k]] -= 8;
+    }
+
+    for (int k = 0; k < spCount; k++)
+        bits[count++] = spBits[k];
+    for (int k = 0; k < count; k++, (*now)++)
+        data[*now >> 3] |= bits[k] << (*now & 7);
+}
+
+static rdhStatus refEmbed(uint8_t *img1, uint8_t *img2, int w, int h,
+                          uint8_t *m, int *mSize, const uint8_t *data, int size)
+{
+    int total = size * 8, now = 0;
+    int b1[9], b2[9];
+    *mSize = 0;
+    for (int x = 0; x + 2 < w; x += 3)
+    {
+        for (int y = 0; y + 2 < h; y += 3)
+        {
+            refBlockLoad(img1, w, x, y, b1);
+            refBlockLoad(img2, w, x, y, b2);
+            m[(*mSize)++] = refEmbedBlock(b1, b2, data, total, &now);
+            refBlockStore(img1, w, x, y, b1);
+            if (now >= total)
+                return RDH_SUCESS;
+        }
+    }
+    return RDH_ERROR;
+}
+
+static void refExtract(uint8_t *img1, uint8_t *img2, int w, int h,
+                       const uint8_t *m, int mSize, uint8_t *data)
+{
+    int now = 0, index = 0;
+    int b1[9], b2[9];
+    for (int x = 0; x + 2 < w && index < mSize; x += 3)
+    {
+        for (int y = 0; y + 2 < h && index < mSize; y += 3)
+        {
+            refBlockLoad(img1, w, x, y, b1);
+            refBlockLoad(img2, w, x, y, b2);
+            refExtractBlock(b1, b2, data, &now, m[index++]);
+            refBlockStore(img1, w, x, y, b1);
+        }
+    }
+}
+
+static void refShuffle(uint8_t *img, int size, uint64_t key)
+{
+    uint64_t *chunk = (uint64_t *)img;
+    size /= 8;
+    xSrand32(key);
+    for (int i = size - 1; i > 0; i--)
+    {
+        int j = xRand32() % (i + 1);
+        uint64_t t = chunk[i];
+        chunk[i] = chunk[j];
+        chunk[j] = t;
+    }
+}
+
+// 记录交换序列后倒序撤销
+static void refUnshuffle(uint8_t *img, int size, uint64_t key)
+{
+    uint64_t *chunk = (uint64_t *)img;
+    size /= 8;
+    if (size <= 1)
+        return;
+    int *swap = (int *)malloc(sizeof(int) * size);
+    xSrand32(key);
+    for (int i = size - 1; i > 0; i--)
+        swap[i] = xRand32() % (i + 1);
+    for (int i = 1; i < size; i++)
+    {
+        uint64_t t = chunk[i];
+        chunk[i] = chunk[swap[i]];
+        chunk[swap[i]] = t;
+    }
+    free(swap);
+}
+
+static void refSplit(const uint8_t *img, int size, uint8_t *img1, uint8_t *img2)
+{
+    xSrand8(rand());
+    for (int i = 0; i < size; i++)
+    {
+        int r = xRand8();
+        int high = img[i] & 0xF8, low = img[i] & 0x07;
+        img1[i] = (uint8_t)((high - (r & 0xF8 & high)) | (low - (r & 0x07 & low)));
+        img2[i] = (uint8_t)((high - (img1[i] & 0xF8)) | (low - (img1[i] & 0x07)));
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * 库的各个变体
+ * ------------------------------------------------------------------------- */
+
+typedef struct
+{
+    const char *name;
+    rdhStatus (*embed)(uint8_t *img1, uint8_t *img2, int w, int h,
+                       uint8_t **m, int *mSize, const uint8_t *data, int size);
+    rdhStatus (*extract)(uint8_t *img1, uint8_t *img2, int w, int h,
+                         const uint8_t *m, int mSize, uint8_t **data, int *dataSize);
+    bool inPlace; // 直接修改份额, 失败时份额可能已被修改
+} diffVariant;
+
+static bool diffProgress(void *arg, int blocks, int bits)
+{
+    (void)arg;
+    (void)blocks;
+    (void)bits;
+    return true;
+}
+
+static rdhStatus diffEmbedPlain(uint8_t *img1, uint8_t *img2, int w, int h,
+                                uint8_t **m, int *mSize, const uint8_t *data, int size)
+{
+    return rdhEmbedData(img1, img2, w, h, m, mSize, data, size);
+}
+static rdhStatus diffExtractPlain(uint8_t *img1, uint8_t *img2, int w, int h,
+                                  const uint8_t *m, int mSize, uint8_t **data, int *dataSize)
+{
+    *dataSize = -1;
+    return rdhExtractData(img1, img2, w, h, m, mSize, data);
+}
+
+// 同时检查统计信息与m一致
+static rdhStatus diffEmbedEx(uint8_t *img1, uint8_t *img2, int w, int h,
+                             uint8_t **m, int *mSize, const uint8_t *data, int size)
+{
+    rdhStats stats;
+    rdhStatsInit(&stats);
+    rdhStatus status = rdhEmbedDataEx(img1, img2, w, h, m, mSize, data, size, &stats, diffProgress, NULL);
+    if (status != RDH_SUCESS)
+        return status;
+
+    int skipped = 0, perBlock = 0, me1 = 0, me2 = 0;
+    for (int i = 0; i < *mSize; i++)
+        skipped += (*m)[i] == 0;
+    for (int i = 0; i <= RDH_STATS_BITS_MAX; i++)
+        perBlock += stats.bitsPerBlock[i];
+    for (int i = 0; i < RDH_STATS_ME_SIZE; i++)
+    {
+        me1 += stats.me1[i];
+        me2 += stats.me2[i];
+    }
+    DIFF_CHECK(stats.blocksSkipped == skipped && stats.blocksUsed == *mSize - skipped,
+               "rdhStats: 块数 %d/%d 与m不一致 (%d/%d)", stats.blocksSkipped, stats.blocksUsed, skipped, *mSize - skipped);
+    DIFF_CHECK(stats.bits == (int64_t)size * 8, "rdhStats: bit数 %lld, 应为 %d", (long long)stats.bits, size * 8);
+    DIFF_CHECK(perBlock == stats.blocksUsed && me1 == stats.blocksUsed && me2 == stats.blocksUsed,
+               "rdhStats: 直方图总数与块数不一致");
+    DIFF_CHECK(stats.blocksShifted <= stats.blocksUsed, "rdhStats: 平移块数超过块数");
+    return status;
+}
+static rdhStatus diffExtractEx(uint8_t *img1, uint8_t *img2, int w, int h,
+                               const uint8_t *m, int mSize, uint8_t **data, int *dataSize)
+{
+    return rdhExtractDataEx(img1, img2, w, h, m, mSize, data, dataSize, diffProgress, NULL);
+}
+
+static rdhStatus diffEmbedJob(uint8_t *img1, uint8_t *img2, int w, int h,
+                              uint8_t **m, int *mSize, const uint8_t *data, int size)
+{
+    rdhJob *job = rdhJobEmbed(img1, img2, w, h, data, size, NULL, NULL);
+    rdhStatus status = rdhJobWait(job);
+    if (status == RDH_SUCESS)
+        rdhJobResult(job, m, mSize);
+    rdhJobDestroy(job);
+    return status;
+}
+static rdhStatus diffExtractJob(uint8_t *img1, uint8_t *img2, int w, int h,
+                                const uint8_t *m, int mSize, uint8_t **data, int *dataSize)
+{
+    rdhJob *job = rdhJobExtract(img1, img2, w, h, m, mSize, NULL, NULL);
+    rdhStatus status = rdhJobWait(job);
+    if (status == RDH_SUCESS)
+        rdhJobResult(job, data, dataSize);
+    rdhJobDestroy(job);
+    return status;
+}
+
+// 自定义分配器, 在每块空间前记录魔数以检查配对
+#define DIFF_ALLOC_MAGIC 0x4D494544
+static int diffAllocLive = 0;
+static void *diffAllocMalloc(void *arg, size_t size)
+{
+    (void)arg;
+    uint32_t *p = (uint32_t *)malloc(size + 16);
+    p[0] = DIFF_ALLOC_MAGIC;
+    diffAllocLive++;
+    return (uint8_t *)p + 16;
+}
+static void diffAllocFree(void *arg, void *data)
+{
+    (void)arg;
+    uint32_t *p = (uint32_t *)((uint8_t *)data - 16);
+    DIFF_CHECK(p[0] == DIFF_ALLOC_MAGIC, "rdhFree 释放了不是分配器分配的空间");
+    p[0] = 0;
+    diffAllocLive--;
+    free(p);
+}
+
+static rdhStatus diffEmbedAlloc(uint8_t *img1, uint8_t *img2, int w, int h,
+                                uint8_t **m, int *mSize, const uint8_t *data, int size)
+{
+    rdhSetAllocator(diffAllocMalloc, diffAllocFree, NULL);
+    rdhStatus status = rdhEmbedData(img1, img2, w, h, m, mSize, data, size);
+    if (status == RDH_SUCESS)
+    {
+        // 结果复制到默认分配器的空间, 以便统一释放
+        uint8_t *copy = (uint8_t *)malloc(*mSize + 1);
+        memcpy(copy, *m, *mSize);
+        rdhFree(*m);
+        *m = copy;
+    }
+    rdhSetAllocator(NULL, NULL, NULL);
+    DIFF_CHECK(diffAllocLive == 0, "自定义分配器泄漏 %d 块", diffAllocLive);
+    return status;
+}
+static rdhStatus diffExtractAlloc(uint8_t *img1, uint8_t *img2, int w, int h,
+                                  const uint8_t *m, int mSize, uint8_t **data, int *dataSize)
+{
+    rdhSetAllocator(diffAllocMalloc, diffAllocFree, NULL);
+    rdhStatus status = rdhExtractDataEx(img1, img2, w, h, m, mSize, data, dataSize, NULL, NULL);
+    if (status == RDH_SUCESS)
+    {
+        uint8_t *copy = (uint8_t *)malloc(*dataSize + 1);
+        memcpy(copy, *data, *dataSize);
+        rdhFree(*data);
+        *data = copy;
+    }
+    rdhSetAllocator(NULL, NULL, NULL);
+    DIFF_CHECK(diffAllocLive == 0, "自定义分配器泄漏 %d 块", diffAllocLive);
+    return status;
+}
+
+// 在线程池工作线程上运行
+static rdhPool *diffPool = NULL;
+typedef struct
+{
+    uint8_t *img1, *img2;
+    int w, h;
+    uint8_t **out;
+    int *outSize;
+    const uint8_t *in;
+    int inSize;
+    rdhStatus status;
+} diffPoolTask;
+
+static void diffPoolEmbedRun(int worker, void *arg)
+{
+    (void)worker;
+    diffPoolTask *t = (diffPoolTask *)arg;
+    t->status = rdhEmbedData(t->img1, t->img2, t->w, t->h, t->out, t->outSize, t->in, t->inSize);
+}
+static void diffPoolExtractRun(int worker, void *arg)
+{
+    (void)worker;
+    diffPoolTask *t = (diffPoolTask *)arg;
+    t->status = rdhExtractDataEx(t->img1, t->img2, t->w, t->h, t->in, t->inSize, t->out, t->outSize, NULL, NULL);
+}
+static rdhStatus diffEmbedPool(uint8_t *img1, uint8_t *img2, int w, int h,
+                               uint8_t **m, int *mSize, const uint8_t *data, int size)
+{
+    diffPoolTask t = {img1, img2, w, h, m, mSize, data, size, RDH_ERROR};
+    rdhPoolSubmit(diffPool, diffPoolEmbedRun, &t);
+    rdhPoolWait(diffPool);
+    return t.status;
+}
+static rdhStatus diffExtractPool(uint8_t *img1, uint8_t *img2, int w, int h,
+                                 const uint8_t *m, int mSize, uint8_t **data, int *dataSize)
+{
+    diffPoolTask t = {img1, img2, w, h, data, dataSize, m, mSize, RDH_ERROR};
+    rdhPoolSubmit(diffPool, diffPoolExtractRun, &t);
+    rdhPoolWait(diffPool);
+    return t.status;
+}
+
+// m使用调用者提供的空间
+static rdhStatus diffEmbedTo(uint8_t *img1, uint8_t *img2, int w, int h,
+                             uint8_t **m, int *mSize, const uint8_t *data, int size)
+{
+    *m = (uint8_t *)rdhMalloc((w / 3) * (h / 3));
+    rdhStatus status = rdhEmbedDataTo(img1, img2, w, h, *m, mSize, data, size);
+    if (status != RDH_SUCESS)
+    {
+        rdhFree(*m);
+        *m = NULL;
+    }
+    return status;
+}
+
+static const diffVariant diffVariantList[] = {
+    {"rdhEmbedData/rdhExtractData", diffEmbedPlain, diffExtractPlain},
+    {"rdhEmbedDataEx/rdhExtractDataEx+progress", diffEmbedEx, diffExtractEx},
+    {"rdhJob", diffEmbedJob, diffExtractJob},
+    {"rdhSetAllocator", diffEmbedAlloc, diffExtractAlloc},
+    {"rdhPool", diffEmbedPool, diffExtractPool},
+    {"rdhEmbedDataTo", diffEmbedTo, diffExtractPlain, true},
+};
+#define DIFF_VARIANT_NUM (int)(sizeof(diffVariantList) / sizeof(diffVariantList[0]))
+
+/* ---------------------------------------------------------------------------
+ * 测试用例
+ * ------------------------------------------------------------------------- */
+
+enum
+{
+    DIFF_IMG_RANDOM,   // 完全随机
+    DIFF_IMG_SMOOTH,   // 平滑渐变, 容量较大
+    DIFF_IMG_OVERFLOW, // 份额1所有像素大于RDH_EP_VALUE_MAX, 所有块都溢出
+    DIFF_IMG_MIXED,    // 平滑图像, 份额1中夹杂溢出像素
+    DIFF_IMG_NUM
+};
+
+static void diffGenImage(uint8_t *img, int w, int h, int type)
+{
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            img[y * w + x] = (uint8_t)(type == DIFF_IMG_RANDOM ? rand() : (x * 3 + y * 2) % 200 + rand() % 5);
+}
+
+// 溢出检查只看份额1, 因此直接修改份额1
+static void diffGenOverflow(uint8_t *share1, int n, int type)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (type == DIFF_IMG_OVERFLOW)
+            share1[i] = (uint8_t)(RDH_OVERFLOW_MIN + rand() % (0x100 - RDH_OVERFLOW_MIN));
+        else if (type == DIFF_IMG_MIXED && rand() % 16 == 0)
+            share1[i] = 0xFF;
+    }
+}
+
+static const char *diffImageName[DIFF_IMG_NUM] = {"random", "smooth", "overflow", "mixed"};
+
+static void diffShuffle(int size)
+{
+    uint8_t *img = (uint8_t *)malloc(size + 1);
+    uint8_t *ref = (uint8_t *)malloc(size + 1);
+    uint8_t *orig = (uint8_t *)malloc(size + 1);
+    for (int i = 0; i < size; i++)
+        orig[i] = (uint8_t)rand();
+    uint64_t key = (uint64_t)rand() << 32 | rand();
+
+    memcpy(img, orig, size);
+    memcpy(ref, orig, size);
+    rdhShuffleImage(img, size, key);
+    refShuffle(ref, size, key);
+    DIFF_CHECK(memcmp(img, ref, size) == 0, "rdhShuffleImage 与参考实现不一致 size=%d", size);
+
+    rdhUnshuffleImage(img, size, key);
+    refUnshuffle(ref, size, key);
+    DIFF_CHECK(memcmp(ref, orig, size) == 0, "参考洗牌往返失败 size=%d", size);
+    DIFF_CHECK(memcmp(img, orig, size) == 0, "rdhUnshuffleImage 未恢复原图 size=%d", size);
+
+    free(img);
+    free(ref);
+    free(orig);
+}
+
+static void diffSplit(int size)
+{
+    uint8_t *img = (uint8_t *)malloc(size + 1);
+    uint8_t *ref1 = (uint8_t *)malloc(size + 1);
+    uint8_t *ref2 = (uint8_t *)malloc(size + 1);
+    uint8_t *to1 = (uint8_t *)malloc(size + 1);
+    uint8_t *to2 = (uint8_t *)malloc(size + 1);
+    uint8_t *out = (uint8_t *)malloc(size + 1);
+    uint8_t *a1, *a2, *combined;
+    for (int i = 0; i < size; i++)
+        img[i] = (uint8_t)rand();
+    unsigned int seed = (unsigned int)rand();
+
+    srand(seed);
+    refSplit(img, size, ref1, ref2);
+    srand(seed);
+    rdhSplitImageTo(img, size, to1, to2);
+    srand(seed);
+    rdhSplitImage(img, size, &a1, &a2);
+
+    DIFF_CHECK(memcmp(to1, ref1, size) == 0 && memcmp(to2, ref2, size) == 0,
+               "rdhSplitImageTo 与参考实现不一致 size=%d", size);
+    DIFF_CHECK(memcmp(a1, ref1, size) == 0 && memcmp(a2, ref2, size) == 0,
+               "rdhSplitImage 与参考实现不一致 size=%d", size);
+
+    rdhCombineImageTo(to1, to2, size, out);
+    rdhCombineImage(a1, a2, size, &combined);
+    DIFF_CHECK(memcmp(out, img, size) == 0, "rdhCombineImageTo 未恢复原图 size=%d", size);
+    DIFF_CHECK(memcmp(combined, img, size) == 0, "rdhCombineImage 未恢复原图 size=%d", size);
+
+    srand(seed + 1);
+    rdhSplitImageTo(img, size, to1, to2);
+    bool same = true;
+    for (int i = 0; i < size; i++)
+        same = same && (uint8_t)(to1[i] + to2[i]) == img[i];
+    DIFF_CHECK(same, "份额之和不等于原图 size=%d", size);
+
+    rdhFree(a1);
+    rdhFree(a2);
+    rdhFree(combined);
+    free(img);
+    free(ref1);
+    free(ref2);
+    free(to1);
+    free(to2);
+    free(out);
+}
+
+static void diffEmbed(int w, int h, int type, int size)
+{
+    int n = w * h;
+    int blocks = (w / 3) * (h / 3);
+    uint8_t *img = (uint8_t *)malloc(n);
+    uint8_t *share1 = (uint8_t *)malloc(n);
+    uint8_t *share2 = (uint8_t *)malloc(n);
+    uint8_t *ref1 = (uint8_t *)malloc(n);
+    uint8_t *ref2 = (uint8_t *)malloc(n);
+    uint8_t *refM = (uint8_t *)malloc(blocks + 1);
+    uint8_t *refData = (uint8_t *)calloc(blocks * 2 + 8, 1);
+    uint8_t *work1 = (uint8_t *)malloc(n);
+    uint8_t *work2 = (uint8_t *)malloc(n);
+    uint8_t *payload = (uint8_t *)malloc(size + 1);
+    int refMSize;
+
+    diffGenImage(img, w, h, type);
+    rdhSplitImageTo(img, n, share1, share2);
+    diffGenOverflow(share1, n, type);
+    for (int i = 0; i < size; i++)
+        payload[i] = (uint8_t)rand();
+
+    // 参考结果
+    memcpy(ref1, share1, n);
+    memcpy(ref2, share2, n);
+    rdhStatus refStatus = refEmbed(ref1, ref2, w, h, refM, &refMSize, payload, size);
+    if (refStatus == RDH_SUCESS)
+    {
+        uint8_t *t1 = (uint8_t *)malloc(n);
+        uint8_t *t2 = (uint8_t *)malloc(n);
+        memcpy(t1, ref1, n);
+        memcpy(t2, ref2, n);
+        refExtract(t1, t2, w, h, refM, refMSize, refData);
+        DIFF_CHECK(memcmp(t1, share1, n) == 0 && memcmp(t2, share2, n) == 0,
+                   "参考实现未恢复份额 %dx%d %s", w, h, diffImageName[type]);
+        DIFF_CHECK(memcmp(refData, payload, size) == 0,
+                   "参考实现提取的数据错误 %dx%d %s", w, h, diffImageName[type]);
+        free(t1);
+        free(t2);
+    }
+    if (type == DIFF_IMG_OVERFLOW)
+        DIFF_CHECK(refStatus == RDH_ERROR || size == 0, "全溢出图像不应能嵌入数据 %dx%d", w, h);
+
+    for (int v = 0; v < DIFF_VARIANT_NUM; v++)
+    {
+        const diffVariant *var = &diffVariantList[v];
+        uint8_t *m = NULL, *data = NULL;
+        int mSize = 0, dataSize = 0;
+
+        memcpy(work1, share1, n);
+        memcpy(work2, share2, n);
+        rdhStatus status = var->embed(work1, work2, w, h, &m, &mSize, payload, size);
+        DIFF_CHECK(status == refStatus, "%s: 嵌入状态 %d, 参考 %d (%dx%d %s size=%d)",
+                   var->name, status, refStatus, w, h, diffImageName[type], size);
+        if (status != RDH_SUCESS)
+        {
+            // 失败时份额不能被修改
+            if (var->inPlace == false)
+                DIFF_CHECK(memcmp(work1, share1, n) == 0 && memcmp(work2, share2, n) == 0,
+                           "%s: 嵌入失败但份额被修改 (%dx%d %s)", var->name, w, h, diffImageName[type]);
+            continue;
+        }
+        if (refStatus != RDH_SUCESS)
+        {
+            rdhFree(m);
+            continue;
+        }
+
+        DIFF_CHECK(mSize == refMSize && memcmp(m, refM, mSize) == 0,
+                   "%s: m与参考实现不一致 (%dx%d %s size=%d)", var->name, w, h, diffImageName[type], size);
+        DIFF_CHECK(memcmp(work1, ref1, n) == 0 && memcmp(work2, ref2, n) == 0,
+                   "%s: 嵌入后的份额与参考实现不一致 (%dx%d %s size=%d)", var->name, w, h, diffImageName[type], size);
+
+        status = var->extract(work1, work2, w, h, m, mSize, &data, &dataSize);
+        DIFF_CHECK(status == RDH_SUCESS, "%s: 提取失败 (%dx%d %s)", var->name, w, h, diffImageName[type]);
+        if (status == RDH_SUCESS)
+        {
+            DIFF_CHECK(memcmp(data, payload, size) == 0,
+                       "%s: 提取的数据错误 (%dx%d %s size=%d)", var->name, w, h, diffImageName[type], size);
+            DIFF_CHECK(dataSize < 0 || dataSize >= size,
+                       "%s: 提取的数据大小 %d 小于 %d", var->name, dataSize, size);
+            DIFF_CHECK(memcmp(work1, share1, n) == 0 && memcmp(work2, share2, n) == 0,
+                       "%s: 提取后份额未恢复 (%dx%d %s)", var->name, w, h, diffImageName[type]);
+        }
+
+        // 主线程使用默认分配器, 各变体的结果都可以用rdhFree释放
+        rdhFree(m);
+        rdhFree(data);
+    }
+
+    free(img);
+    free(share1);
+    free(share2);
+    free(ref1);
+    free(ref2);
+    free(refM);
+    free(refData);
+    free(work1);
+    free(work2);
+    free(payload);
+}
+
+/**
+ * \brief 无效的数据大小应当直接失败, 不能在转换为bit数时溢出
+ */
+static void diffEmbedInvalid(void)
+{
+    enum { w = 9, h = 9 };
+    uint8_t img1[w * h], img2[w * h], data[1] = {0};
+    static const int sizes[] = {-1, RDH_DATA_SIZE_MAX + 1, INT_MAX};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        memset(img1, 0x55, sizeof(img1));
+        memset(img2, 0xAA, sizeof(img2));
+        uint8_t *m = (uint8_t *)1;
+        int mSize = -1;
+        rdhStatus status = rdhEmbedDataEx(img1, img2, w, h, &m, &mSize, data, sizes[i], NULL, NULL, NULL);
+        DIFF_CHECK(status == RDH_ERROR && m == NULL && mSize == 0,
+                   "rdhEmbedDataEx: 数据大小 %d 应当失败, 状态 %d", sizes[i], status);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : DIFF_ROUNDS;
+    unsigned int seed = argc > 2 ? (unsigned int)strtoul(argv[2], NULL, 10) : DIFF_SEED;
+    srand(seed);
+    diffPool = rdhPoolCreate(2);
+
+    diffEmbedInvalid();
+
+    // 边界尺寸, 包括不是3和8的倍数的情况
+    static const int sizes[][2] = {{3, 3}, {4, 4}, {5, 7}, {8, 3}, {10, 11}, {31, 17}, {64, 65}, {100, 99}, {128, 128}};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        int w = sizes[s][0], h = sizes[s][1];
+        diffShuffle(w * h);
+        diffSplit(w * h);
+        for (int type = 0; type < DIFF_IMG_NUM; type++)
+        {
+            diffEmbed(w, h, type, 0);
+            diffEmbed(w, h, type, 1);
+            diffEmbed(w, h, type, (w / 3) * (h / 3) / 8 + 1);
+        }
+    }
+
+    // 随机尺寸和载荷
+    for (int r = 0; r < rounds; r++)
+    {
+        int w = 3 + rand() % 200, h = 3 + rand() % 200;
+        int blocks = (w / 3) * (h / 3);
+        diffShuffle(w * h);
+        diffSplit(w * h);
+        for (int type = 0; type < DIFF_IMG_NUM; type++)
+            diffEmbed(w, h, type, rand() % (blocks / 4 + 2));
+    }
+
+    rdhPoolDestroy(diffPool);
+
+    printf("rdh_diff: %d 项检查, %d 项失败 (种子 %u)\n", diffChecks, diffFailures, seed);
+    return diffFailures ? 1 : 0;
+}
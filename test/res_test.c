@@ -0,0 +1,316 @@
+/**
+ * \file res_test.c
+ * \brief 资源缓存测试
+ *
+ * 读取mie-pack打包的res_fixture, 检查未压缩和zlib压缩的文件的内容, 内存预算下的命中,
+ * 未命中和淘汰, 以及从冲突的探测序列(跨过哈希表结尾)中间删除资源后其余资源仍能找到.
+ * 失败时返回非0, 由ctest运行
+ *
+ * res_test <资源目录> <原始文件目录>
+ */
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "resource.h"
+#include "resource_pack.h"
+
+#define RES_TEST_MASK 63 // 哈希表初始容量(64)的掩码
+
+static int testChecks = 0;   // 检查次数
+static int testFailures = 0; // 失败次数
+
+#define TEST_CHECK(cond, ...)                                \
+    do                                                       \
+    {                                                        \
+        testChecks++;                                        \
+        if (!(cond))                                         \
+        {                                                    \
+            testFailures++;                                  \
+            fprintf(stderr, "[%s:%d] ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                    \
+            fprintf(stderr, "\n");                           \
+        }                                                    \
+    } while (0)
+
+// 理想位置都在哈希表倒数第二个槽的文件, 依次占据最后两个槽和开头两个槽
+static const char *testChain[] = {"chain107.txt", "chain235.txt", "chain240.txt", "chain279.txt"};
+#define TEST_CHAIN_COUNT 4
+#define TEST_HOME "home26.txt" // 理想位置是第一个槽, 被探测序列挤到后面
+
+static const char *testOrigin; // 原始文件目录
+
+/**
+ * \brief 与resource.c相同的FNV-1a哈希, 用于检查测试数据的前提
+ */
+static uint32_t testHash(const char *s)
+{
+    uint32_t hash = 2166136261u;
+    for (; *s; s++)
+        hash = (hash ^ (uint8_t)*s) * 16777619u;
+    return hash;
+}
+
+/**
+ * \brief 读取整个文件
+ */
+static uint8_t *testRead(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return NULL;
+
+    fseek(fp, 0L, SEEK_END);
+    long fileSize = ftell(fp);
+    fseek(fp, 0L, SEEK_SET);
+
+    uint8_t *data = fileSize >= 0 ? malloc((size_t)fileSize + 1) : NULL;
+    if (data && fread(data, 1, (size_t)fileSize, fp) != (size_t)fileSize)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+
+    *size = (size_t)fileSize;
+    return data;
+}
+
+/**
+ * \brief 获取资源, 检查内容与原始文件相同且结尾有0
+ */
+static void testGet(const char *name)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", testOrigin, name);
+    size_t expectSize = 0;
+    uint8_t *expect = testRead(path, &expectSize);
+    TEST_CHECK(expect != NULL, "无法读取原始文件 %s", name);
+
+    uint8_t *data = NULL;
+    size_t size = 0;
+    uint8_t *ret = resGetFile(name, &data, &size, false);
+    TEST_CHECK(ret != NULL && ret == data, "%s 加载失败", name);
+    if (ret && expect)
+    {
+        TEST_CHECK(size == expectSize && memcmp(data, expect, size) == 0, "%s 内容不同", name);
+        TEST_CHECK(data[size] == '\0', "%s 结尾没有0", name);
+    }
+    free(expect);
+}
+
+/**
+ * \brief 检查统计相对于base的变化
+ */
+static void testStats(const resStats *base, int hits, int misses, int evictions, const char *what)
+{
+    resStats stats;
+    resGetStats(&stats);
+    TEST_CHECK(stats.hits - base->hits == (uint64_t)hits && stats.misses - base->misses == (uint64_t)misses &&
+                   stats.evictions - base->evictions == (uint64_t)evictions,
+               "%s: 命中 %llu 未命中 %llu 淘汰 %llu, 期望 %d %d %d", what,
+               (unsigned long long)(stats.hits - base->hits), (unsigned long long)(stats.misses - base->misses),
+               (unsigned long long)(stats.evictions - base->evictions), hits, misses, evictions);
+}
+
+/**
+ * \brief 检查资源包中同时有未压缩和压缩的文件, 冲突的文件名落在同一个槽
+ */
+static void testFixture(const char *pack)
+{
+    for (int i = 0; i < TEST_CHAIN_COUNT; i++)
+        TEST_CHECK((testHash(testChain[i]) & RES_TEST_MASK) == RES_TEST_MASK - 1, "%s 的理想位置不是倒数第二个槽",
+                   testChain[i]);
+    TEST_CHECK((testHash(TEST_HOME) & RES_TEST_MASK) == 0, "%s 的理想位置不是第一个槽", TEST_HOME);
+
+    size_t size = 0;
+    uint8_t *data = testRead(pack, &size);
+    TEST_CHECK(data != NULL, "无法读取资源包 %s", pack);
+    if (data == NULL)
+        return;
+    const resPackHeader *header = (const resPackHeader *)data;
+    bool stored = false, zlib = false;
+    if (size >= sizeof(resPackHeader) && strcmp(header->magic, RES_PACK_MAGIC) == 0 &&
+        size >= sizeof(resPackHeader) + header->count * sizeof(resPackEntry))
+    {
+        const resPackEntry *toc = (const resPackEntry *)(header + 1);
+        for (uint32_t i = 0; i < header->count; i++)
+        {
+            stored |= toc[i].method == RES_PACK_STORED;
+            zlib |= toc[i].method == RES_PACK_ZLIB;
+        }
+    }
+    TEST_CHECK(stored && zlib, "资源包中没有同时包含未压缩和压缩的文件");
+    free(data);
+}
+
+/**
+ * \brief 查找未压缩和压缩的文件, 以及不存在的文件
+ */
+static void testLookup(void)
+{
+    resStats base;
+    resGetStats(&base);
+
+    testGet("small.txt");
+    testGet("noise.bin");
+    testGet("large.txt");
+    testGet("large.txt");
+    TEST_CHECK(resGetFile("missing.txt", NULL, NULL, false) == NULL, "不存在的文件加载成功");
+    testStats(&base, 1, 3, 0, "查找");
+
+    resRelease("small.txt");
+    resRelease("noise.bin");
+    resRelease("large.txt");
+    resRelease("large.txt");
+    resSetBudget(0);
+    testStats(&base, 1, 3, 3, "释放查找的文件");
+}
+
+/**
+ * \brief 内存预算只够一个文件时, 加载另一个文件会淘汰没有引用的文件
+ */
+static void testBudget(void)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/large.txt", testOrigin);
+    size_t large = 0;
+    free(testRead(path, &large));
+    resSetBudget(large);
+
+    resStats base;
+    resGetStats(&base);
+
+    testGet("large.txt");
+    resRelease("large.txt");
+    testGet("large.txt"); // 没有超出预算, 仍在缓存中
+    resRelease("large.txt");
+    testStats(&base, 1, 1, 0, "预算内");
+
+    testGet("chain107.txt"); // 超出预算, 淘汰large.txt
+    testStats(&base, 1, 2, 1, "超出预算");
+    testGet("large.txt");    // 重新加载, chain107.txt仍有引用, 不淘汰
+    testStats(&base, 1, 3, 1, "有引用时不淘汰");
+    resRelease("chain107.txt");
+    testStats(&base, 1, 3, 2, "释放后淘汰");
+
+    resStats stats;
+    resGetStats(&stats);
+    TEST_CHECK(stats.bytes == large && stats.budget == large, "占用 %zu 预算 %zu, 期望 %zu", stats.bytes, stats.budget,
+               large);
+
+    resRelease("large.txt");
+    resSetBudget(0);
+    testStats(&base, 1, 3, 3, "预算为0");
+}
+
+/**
+ * \brief 依次淘汰探测序列开头和中间的文件, 其余文件仍然命中
+ */
+static void testChainRemove(void)
+{
+    resSetBudget(0);
+    resStats base;
+    resGetStats(&base);
+
+    // 四个冲突的文件占据最后两个槽和开头两个槽, home26.txt被挤到第三个槽
+    int refs[TEST_CHAIN_COUNT + 1] = {0}; // 每个文件持有的引用, 最后一个是home26.txt
+    for (int i = 0; i < TEST_CHAIN_COUNT; i++)
+    {
+        testGet(testChain[i]);
+        refs[i]++;
+    }
+    testGet(TEST_HOME);
+    refs[TEST_CHAIN_COUNT]++;
+    int hits = 0, misses = 5, evictions = 0;
+    testStats(&base, hits, misses, evictions, "加载冲突的文件");
+
+    // 先删除第一个槽中的chain240.txt, 后面的文件需要跨过结尾前移; 再删除探测序列开头的chain107.txt
+    const int removed[] = {2, 0};
+    for (int r = 0; r < 2; r++)
+    {
+        const char *name = testChain[removed[r]];
+        while (refs[removed[r]] > 0)
+        {
+            resRelease(name);
+            refs[removed[r]]--;
+        }
+        testStats(&base, hits, misses, ++evictions, name);
+
+        for (int i = 0; i <= TEST_CHAIN_COUNT; i++)
+        {
+            if (refs[i] == 0)
+                continue;
+            testGet(i < TEST_CHAIN_COUNT ? testChain[i] : TEST_HOME);
+            refs[i]++;
+            hits++;
+        }
+        testStats(&base, hits, misses, evictions, "删除后查找其余文件");
+    }
+
+    // 被删除的文件重新加载
+    for (int r = 0; r < 2; r++)
+    {
+        testGet(testChain[removed[r]]);
+        refs[removed[r]]++;
+        misses++;
+    }
+    testStats(&base, hits, misses, evictions, "重新加载删除的文件");
+
+    // 释放全部引用后全部淘汰
+    for (int i = 0; i <= TEST_CHAIN_COUNT; i++)
+        while (refs[i]-- > 0)
+            resRelease(i < TEST_CHAIN_COUNT ? testChain[i] : TEST_HOME);
+    testStats(&base, hits, misses, evictions + 5, "释放全部冲突的文件");
+}
+
+/**
+ * \brief 预加载, 不存在的文件也算结束
+ */
+static void testPrefetch(void)
+{
+    resSetBudget((size_t)256 << 20);
+    resStats base;
+    resGetStats(&base);
+
+    const char *names[] = {"large.txt", "noise.bin", "missing.txt"};
+    resFuture *future = resPrefetch(names, 3, false);
+    TEST_CHECK(future != NULL, "预加载失败");
+    TEST_CHECK(resFutureWait(future) == false, "不存在的文件预加载成功");
+    int loaded = 0;
+    TEST_CHECK(resFuturePoll(future, &loaded) && loaded == 3, "预加载结束 %d 个文件, 期望 3", loaded);
+
+    testGet("large.txt");
+    testStats(&base, 1, 2, 0, "预加载后命中");
+    resRelease("large.txt");
+    resFutureRelease(future);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "用法: res_test <资源目录> <原始文件目录>\n");
+        return 1;
+    }
+    testOrigin = argv[2];
+
+    char pack[512];
+    snprintf(pack, sizeof(pack), "%s%s", argv[1], RES_PACK_SUFFIX);
+    testFixture(pack);
+
+    resInit(argv[1]);
+    testLookup();
+    testBudget();
+    testChainRemove();
+    testPrefetch();
+    resQuit();
+
+    printf("资源缓存测试: %d 次检查, %d 次失败\n", testChecks, testFailures);
+    return testFailures ? 1 : 0;
+}